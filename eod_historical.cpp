@@ -1,5 +1,5 @@
 // eod_historical_data.cpp - https://eodhistoricaldata.com/
-#include "xll/xll/xll.h"
+#include "xll_inet.h"
 
 using namespace xll;
 
@@ -44,6 +44,7 @@ AddIn xai_eod_historical(
 	.Category("EOD")
 	.Documentation(R"(
 Return URL for end-of-day data for <code>symbol</code> between <code>from</code> and <code>_to</code> date.
+If <code>INET.PREFETCH(TRUE)</code> was called the URL is read in the background.
 )")
 );
 LPOPER WINAPI xll_eod_historical(LPCTSTR symbol, double from, double to, LPCTSTR period, BOOL desc)
@@ -69,6 +70,8 @@ LPOPER WINAPI xll_eod_historical(LPCTSTR symbol, double from, double to, LPCTSTR
 		}
 		result &= "&order=";
 		result &= desc ? "d" : "a";
+
+		Inet::prefetch_url(result);
 	}
 	catch (const std::exception& ex) {
 		XLL_ERROR(ex.what());
@@ -0,0 +1,323 @@
+// fms_charset.h - transcode response bodies to UTF-8 as they arrive
+// https://encoding.spec.whatwg.org/
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace fms::charset {
+
+	enum class encoding {
+		utf8, // or unknown, passed through unchanged
+		windows1252, // also used for ISO-8859-1 and US-ASCII labels as browsers do
+		utf16le,
+		utf16be,
+	};
+
+	inline const char* name(encoding e)
+	{
+		switch (e) {
+		case encoding::utf8: return "UTF-8";
+		case encoding::windows1252: return "windows-1252";
+		case encoding::utf16le: return "UTF-16LE";
+		case encoding::utf16be: return "UTF-16BE";
+		}
+
+		return "";
+	}
+
+	// ASCII case insensitive equality
+	inline bool iequal(std::string_view a, std::string_view b)
+	{
+		if (a.size() != b.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < a.size(); ++i) {
+			char x = a[i], y = b[i];
+			if ('A' <= x and x <= 'Z') x += 'a' - 'A';
+			if ('A' <= y and y <= 'Z') y += 'a' - 'A';
+			if (x != y) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// charset parameter of a Content-Type value, e.g., "text/csv; charset=ISO-8859-1"
+	inline std::string_view parameter(std::string_view content_type)
+	{
+		auto i = content_type.find(';');
+		while (i != content_type.npos) {
+			auto p = content_type.substr(i + 1);
+			i = content_type.find(';', i + 1);
+			if (i != content_type.npos) {
+				p = p.substr(0, p.find(';'));
+			}
+			while (p.size() and (p.front() == ' ' or p.front() == '\t')) {
+				p.remove_prefix(1);
+			}
+			if (p.size() > 8 and iequal(p.substr(0, 8), "charset=")) {
+				p.remove_prefix(8);
+				while (p.size() and (p.back() == ' ' or p.back() == '\t')) {
+					p.remove_suffix(1);
+				}
+				if (p.size() >= 2 and p.front() == '"' and p.back() == '"') {
+					p = p.substr(1, p.size() - 2);
+				}
+
+				return p;
+			}
+		}
+
+		return std::string_view{};
+	}
+
+	// Content-Type is text, JSON, or XML, e.g., "text/csv", "application/ld+json"
+	inline bool textual(std::string_view content_type)
+	{
+		auto t = content_type.substr(0, content_type.find(';'));
+		while (t.size() and (t.front() == ' ' or t.front() == '\t')) {
+			t.remove_prefix(1);
+		}
+		while (t.size() and (t.back() == ' ' or t.back() == '\t')) {
+			t.remove_suffix(1);
+		}
+		auto ends = [t](std::string_view s) {
+			return t.size() > s.size() and iequal(t.substr(t.size() - s.size()), s);
+		};
+
+		return (t.size() > 5 and iequal(t.substr(0, 5), "text/"))
+			or ends("/json") or ends("+json") or ends("/xml") or ends("+xml");
+	}
+
+	// encoding having label or utf8 if not supported
+	inline encoding label(std::string_view l)
+	{
+		for (auto s : { "windows-1252", "cp1252", "x-cp1252", "iso-8859-1", "iso8859-1", "latin1", "l1", "us-ascii", "ascii" }) {
+			if (iequal(l, s)) {
+				return encoding::windows1252;
+			}
+		}
+		for (auto s : { "utf-16le", "utf-16" }) {
+			if (iequal(l, s)) {
+				return encoding::utf16le;
+			}
+		}
+		if (iequal(l, "utf-16be")) {
+			return encoding::utf16be;
+		}
+
+		return encoding::utf8;
+	}
+
+	inline void append(std::string& s, char32_t c)
+	{
+		if (c < 0x80) {
+			s.push_back(static_cast<char>(c));
+		}
+		else if (c < 0x800) {
+			s.push_back(static_cast<char>(0xC0 | (c >> 6)));
+			s.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+		}
+		else if (c < 0x10000) {
+			s.push_back(static_cast<char>(0xE0 | (c >> 12)));
+			s.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+			s.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+		}
+		else {
+			s.push_back(static_cast<char>(0xF0 | (c >> 18)));
+			s.push_back(static_cast<char>(0x80 | ((c >> 12) & 0x3F)));
+			s.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+			s.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+		}
+	}
+
+	// Decode chunks of a body to UTF-8 keeping partial code units between chunks.
+	// If bom is true a UTF-16 byte order mark at the start overrides the declared encoding.
+	class decoder {
+		encoding e;
+		bool start = true; // byte order mark not checked yet
+		std::string carry; // bytes of an incomplete code unit or surrogate pair
+		std::string out;
+
+		// 0x80 - 0x9F, the rest of windows-1252 is ISO-8859-1
+		static char32_t windows1252(unsigned char b)
+		{
+			static constexpr char16_t c1[32] = {
+				0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+				0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+				0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+				0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+			};
+
+			return 0x80 <= b and b < 0xA0 ? c1[b - 0x80] : b;
+		}
+
+		// UTF-16 code unit at s
+		char16_t unit(const char* s) const
+		{
+			auto lo = static_cast<unsigned char>(s[e == encoding::utf16le ? 0 : 1]);
+			auto hi = static_cast<unsigned char>(s[e == encoding::utf16le ? 1 : 0]);
+
+			return static_cast<char16_t>((hi << 8) | lo);
+		}
+
+		// decode s and return the number of bytes used
+		size_t utf16(std::string_view s)
+		{
+			size_t i = 0;
+			while (i + 2 <= s.size()) {
+				char32_t u = unit(s.data() + i);
+				if (0xD800 <= u and u < 0xDC00) {
+					if (i + 4 > s.size()) {
+						break; // wait for the low surrogate
+					}
+					char32_t v = unit(s.data() + i + 2);
+					if (0xDC00 <= v and v < 0xE000) {
+						append(out, 0x10000 + ((u - 0xD800) << 10) + (v - 0xDC00));
+						i += 4;
+						continue;
+					}
+					u = 0xFFFD;
+				}
+				else if (0xDC00 <= u and u < 0xE000) {
+					u = 0xFFFD;
+				}
+				append(out, u);
+				i += 2;
+			}
+
+			return i;
+		}
+	public:
+		decoder(encoding e = encoding::utf8, bool bom = true)
+			: e(e), start(bom)
+		{ }
+
+		encoding source() const
+		{
+			return e;
+		}
+
+		// UTF-8 for chunk valid until the next call
+		std::string_view operator()(std::string_view chunk)
+		{
+			out.clear();
+
+			if (start) {
+				if (carry.size() + chunk.size() < 2) {
+					carry.append(chunk);
+
+					return out;
+				}
+				start = false;
+				auto b0 = carry.size() ? carry[0] : chunk[0];
+				auto b1 = carry.size() ? chunk[0] : chunk[1];
+				if ((b0 == '\xFF' and b1 == '\xFE') or (b0 == '\xFE' and b1 == '\xFF')) {
+					e = b0 == '\xFF' ? encoding::utf16le : encoding::utf16be;
+					chunk.remove_prefix(2 - carry.size());
+					carry.clear();
+				}
+				else if (carry.size() and e == encoding::utf8) {
+					out.assign(carry).append(chunk);
+					carry.clear();
+
+					return out;
+				}
+				else if (carry.size() and e == encoding::windows1252) {
+					append(out, windows1252(static_cast<unsigned char>(carry[0])));
+					carry.clear();
+				}
+			}
+
+			if (e == encoding::utf8) {
+				return chunk;
+			}
+			else if (e == encoding::windows1252) {
+				for (auto c : chunk) {
+					append(out, windows1252(static_cast<unsigned char>(c)));
+				}
+			}
+			else {
+				// complete a code unit or surrogate pair split across chunks
+				while (carry.size() and chunk.size()) {
+					carry.push_back(chunk.front());
+					chunk.remove_prefix(1);
+					carry.erase(0, utf16(carry));
+				}
+				if (carry.empty()) {
+					carry.assign(chunk.substr(utf16(chunk)));
+				}
+			}
+
+			return out;
+		}
+
+		// UTF-8 for bytes left at the end of the body
+		std::string_view finish()
+		{
+			out.clear();
+
+			if (carry.size()) {
+				if (start and e == encoding::utf8) {
+					out.assign(carry);
+				}
+				else if (start and e == encoding::windows1252) {
+					append(out, windows1252(static_cast<unsigned char>(carry[0])));
+				}
+				else {
+					append(out, 0xFFFD);
+				}
+				carry.clear();
+			}
+			start = false;
+
+			return out;
+		}
+	};
+
+#ifdef _DEBUG
+
+	inline int test()
+	{
+		ensure(parameter("text/csv; charset=ISO-8859-1") == "ISO-8859-1");
+		ensure(parameter("text/html;Charset=\"utf-8\" ") == "utf-8");
+		ensure(parameter("text/csv; header=present; charset=cp1252; q=1") == "cp1252");
+		ensure(parameter("text/csv") == "");
+		ensure(label("ISO-8859-1") == encoding::windows1252);
+		ensure(label("UTF-16") == encoding::utf16le);
+		ensure(label("utf-8") == encoding::utf8);
+		ensure(label("koi8-r") == encoding::utf8);
+		ensure(textual("text/csv; charset=utf-8") and textual(" Application/JSON") and textual("application/atom+xml"));
+		ensure(!textual("application/octet-stream") and !textual("image/png") and !textual("") and !textual("text/"));
+
+		// decode data split every n bytes
+		auto decode = [](encoding e, std::string_view data, size_t n, bool bom = true) {
+			decoder d(e, bom);
+			std::string s;
+			for (size_t i = 0; i < data.size(); i += n) {
+				s.append(d(data.substr(i, n)));
+			}
+			s.append(d.finish());
+			return s;
+		};
+		for (size_t n = 1; n <= 12; ++n) {
+			ensure(decode(encoding::utf8, "caf\xC3\xA9", n) == "caf\xC3\xA9");
+			ensure(decode(encoding::windows1252, "caf\xE9 \x80", n) == "caf\xC3\xA9 \xE2\x82\xAC");
+			ensure(decode(encoding::utf16le, std::string_view("c\0\xE9\0=\xD8\0\xDE", 8), n) == "c\xC3\xA9\xF0\x9F\x98\x80");
+			ensure(decode(encoding::utf8, std::string_view("\xFE\xFF\0c\0\xE9", 6), n) == "c\xC3\xA9");
+			ensure(decode(encoding::windows1252, std::string_view("\xFF\xFE" "c\0", 4), n) == "c");
+			ensure(decode(encoding::utf8, std::string_view("\xFF\xFE" "c\0", 4), n, false) == std::string_view("\xFF\xFE" "c\0", 4));
+			ensure(decode(encoding::windows1252, "\xFF\xFE", n, false) == "\xC3\xBF\xC3\xBE");
+			ensure(decode(encoding::utf16le, std::string_view("\0\xDC" "c\0", 4), n) == "\xEF\xBF\xBD" "c");
+			ensure(decode(encoding::utf16le, std::string_view("c\0\0", 3), n) == "c\xEF\xBF\xBD");
+			ensure(decode(encoding::utf8, "x", n) == "x");
+			ensure(decode(encoding::windows1252, "\xE9", n) == "\xC3\xA9");
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+
+} // namespace fms::charset
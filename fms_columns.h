@@ -0,0 +1,339 @@
+// fms_columns.h - binary columnar files that can be used in place after mapping
+// A file is a header, one entry per column, then 64-byte aligned blocks.
+// Number, date, and array blocks start with 32-bit rows and columns followed
+// by doubles so a pointer to the block has the layout of an Excel FP12.
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fms::columns {
+
+	constexpr char magic[8] = { 'F', 'M', 'S', 'C', 'O', 'L', 'S', '\0' };
+	constexpr uint32_t version = 1;
+	constexpr size_t align = 64;
+
+	// same order as xll::table::type
+	enum class type : uint32_t { integer, number, date, string, array };
+
+	struct header {
+		char magic[8];
+		uint32_t version;
+		uint32_t columns; // entries after the header
+		uint64_t rows;
+		uint64_t source; // hash of the source bytes and how they were parsed
+		uint64_t size; // bytes in the file
+		uint64_t reserved[3];
+	};
+	static_assert(sizeof(header) == align);
+
+	struct entry {
+		type t;
+		uint32_t width; // columns in the block
+		uint64_t name; // offset of UTF-8 name
+		uint64_t name_size;
+		uint64_t data; // offset of block
+		uint64_t bytes; // in block
+		uint64_t dictionary; // offset of count + 1 string offsets followed by the strings
+		uint64_t count; // strings in dictionary
+		uint64_t reserved;
+	};
+	static_assert(sizeof(entry) == align);
+
+	constexpr uint64_t aligned(uint64_t n)
+	{
+		return (n + align - 1) & ~(align - 1);
+	}
+
+	// Build a file in memory. Blocks are laid out in the order columns are added.
+	class writer {
+		uint64_t source, rows;
+		std::vector<entry> entries;
+		std::string body; // blocks with offsets relative to its start
+
+		uint64_t block(const void* p, size_t n)
+		{
+			body.resize(aligned(body.size()));
+			auto off = body.size();
+			body.append(static_cast<const char*>(p), n);
+
+			return off;
+		}
+		entry& add(type t, std::string_view name)
+		{
+			entry e = {};
+			e.t = t;
+			e.width = 1;
+			e.name_size = name.size();
+			e.name = block(name.data(), name.size());
+			entries.push_back(e);
+
+			return entries.back();
+		}
+	public:
+		writer(uint64_t source, uint64_t rows)
+			: source(source), rows(rows)
+		{ }
+
+		// rows by width doubles in row-major order
+		void doubles(std::string_view name, type t, const double* x, uint32_t width = 1)
+		{
+			auto& e = add(t, name);
+			int32_t shape[2] = { static_cast<int32_t>(rows), static_cast<int32_t>(width) };
+			e.width = width;
+			e.data = block(shape, sizeof(shape));
+			if (rows) {
+				body.append(reinterpret_cast<const char*>(x), rows * width * sizeof(double));
+			}
+			e.bytes = sizeof(shape) + rows * width * sizeof(double);
+		}
+		void integers(std::string_view name, const int64_t* i)
+		{
+			auto& e = add(type::integer, name);
+			e.bytes = rows * sizeof(int64_t);
+			e.data = block(i, e.bytes);
+		}
+		// codes into a dictionary of distinct strings
+		void strings(std::string_view name, const uint32_t* code, const std::vector<std::string>& dictionary)
+		{
+			auto& e = add(type::string, name);
+			e.bytes = rows * sizeof(uint32_t);
+			e.data = block(code, e.bytes);
+
+			std::vector<uint64_t> off(1, 0);
+			for (const auto& s : dictionary) {
+				off.push_back(off.back() + s.size());
+			}
+			e.count = dictionary.size();
+			e.dictionary = block(off.data(), off.size() * sizeof(uint64_t));
+			for (const auto& s : dictionary) {
+				body.append(s);
+			}
+		}
+
+		// the file
+		std::string str() const
+		{
+			auto base = aligned(sizeof(header) + entries.size() * sizeof(entry));
+			header h = {};
+			memcpy(h.magic, magic, sizeof(magic));
+			h.version = version;
+			h.columns = static_cast<uint32_t>(entries.size());
+			h.rows = rows;
+			h.source = source;
+			h.size = base + body.size();
+
+			std::string s(reinterpret_cast<const char*>(&h), sizeof(h));
+			for (auto e : entries) {
+				e.name += base;
+				e.data += base;
+				if (e.t == type::string) {
+					e.dictionary += base;
+				}
+				s.append(reinterpret_cast<const char*>(&e), sizeof(e));
+			}
+			s.resize(base);
+			s.append(body);
+
+			return s;
+		}
+	};
+
+	// Columns of a file in memory. Nothing is copied. Construction checks
+	// every offset so a truncated or corrupt file is not valid.
+	class reader {
+		std::string_view s;
+		const header* h = nullptr;
+		const entry* e = nullptr;
+
+		bool inside(uint64_t off, uint64_t n) const
+		{
+			return off <= s.size() and n <= s.size() - off;
+		}
+		bool check(const entry& c) const
+		{
+			if (!inside(c.name, c.name_size) or !inside(c.data, c.bytes) or c.data % align) {
+				return false;
+			}
+			switch (c.t) {
+			case type::integer:
+				return c.width == 1 and c.bytes == h->rows * sizeof(int64_t);
+			case type::number:
+			case type::date:
+			case type::array:
+				return (c.t == type::array ? 0 < c.width and c.width <= 16384 : c.width == 1)
+					and c.bytes == 2 * sizeof(int32_t) + h->rows * c.width * sizeof(double)
+					and shape(c)[0] == static_cast<int32_t>(h->rows) and shape(c)[1] == static_cast<int32_t>(c.width);
+			case type::string: {
+				if (c.bytes != h->rows * sizeof(uint32_t) or c.count >= UINT32_MAX
+					or c.dictionary % alignof(uint64_t) or !inside(c.dictionary, (c.count + 1) * sizeof(uint64_t))) {
+					return false;
+				}
+				auto off = offsets(c);
+				auto chars = c.dictionary + (c.count + 1) * sizeof(uint64_t);
+				for (uint64_t k = 0; k < c.count; ++k) {
+					if (off[k] > off[k + 1]) {
+						return false;
+					}
+				}
+				if (off[0] != 0 or !inside(chars, off[c.count])) {
+					return false;
+				}
+				auto code = reinterpret_cast<const uint32_t*>(s.data() + c.data);
+				for (uint64_t i = 0; i < h->rows; ++i) {
+					if (code[i] >= c.count) {
+						return false;
+					}
+				}
+				return true;
+			}
+			}
+
+			return false;
+		}
+		const int32_t* shape(const entry& c) const
+		{
+			return reinterpret_cast<const int32_t*>(s.data() + c.data);
+		}
+		const uint64_t* offsets(const entry& c) const
+		{
+			return reinterpret_cast<const uint64_t*>(s.data() + c.dictionary);
+		}
+	public:
+		reader(std::string_view s = {})
+			: s(s)
+		{
+			if (s.size() < sizeof(header) or reinterpret_cast<uintptr_t>(s.data()) % align) {
+				return;
+			}
+			auto h_ = reinterpret_cast<const header*>(s.data());
+			if (memcmp(h_->magic, magic, sizeof(magic)) or h_->version != version or h_->size != s.size()
+				or h_->rows > INT32_MAX or !inside(sizeof(header), uint64_t(h_->columns) * sizeof(entry))) {
+				return;
+			}
+			h = h_;
+			e = reinterpret_cast<const entry*>(s.data() + sizeof(header));
+			for (uint32_t j = 0; j < h->columns; ++j) {
+				if (!check(e[j])) {
+					h = nullptr;
+
+					return;
+				}
+			}
+		}
+
+		explicit operator bool() const
+		{
+			return h != nullptr;
+		}
+
+		uint64_t source() const
+		{
+			return h->source;
+		}
+		size_t rows() const
+		{
+			return h->rows;
+		}
+		size_t size() const
+		{
+			return h->columns;
+		}
+
+		type kind(size_t j) const
+		{
+			return e[j].t;
+		}
+		std::string_view name(size_t j) const
+		{
+			return s.substr(e[j].name, e[j].name_size);
+		}
+		size_t width(size_t j) const
+		{
+			return e[j].width;
+		}
+		// start of a number, date, or array block having the layout of an FP12
+		const void* block(size_t j) const
+		{
+			return s.data() + e[j].data;
+		}
+		const double* doubles(size_t j) const
+		{
+			return reinterpret_cast<const double*>(s.data() + e[j].data + 2 * sizeof(int32_t));
+		}
+		const int64_t* integers(size_t j) const
+		{
+			return reinterpret_cast<const int64_t*>(s.data() + e[j].data);
+		}
+		const uint32_t* codes(size_t j) const
+		{
+			return reinterpret_cast<const uint32_t*>(s.data() + e[j].data);
+		}
+		size_t count(size_t j) const
+		{
+			return e[j].count;
+		}
+		// string k of the dictionary of column j
+		std::string_view word(size_t j, size_t k) const
+		{
+			auto off = offsets(e[j]);
+			auto chars = e[j].dictionary + (e[j].count + 1) * sizeof(uint64_t);
+
+			return s.substr(chars + off[k], off[k + 1] - off[k]);
+		}
+	};
+
+#ifdef _DEBUG
+
+	inline int test()
+	{
+		double px[] = { 1.5, 2, 3.25 };
+		int64_t n[] = { -1, 0, 1LL << 40 };
+		uint32_t code[] = { 0, 1, 0 };
+		double ts[] = { 44200, 1, 44201, 2, 44202, 3 };
+		writer w(0x1234, 3);
+		w.doubles("px", type::number, px);
+		w.integers("n", n);
+		w.strings("sym", code, { "IBM", "" });
+		w.doubles("", type::array, ts, 2);
+		auto f = w.str();
+
+		// readers need aligned memory like a mapped file
+		std::vector<uint64_t> mem(aligned(f.size()) / 8 + 8);
+		auto p = reinterpret_cast<char*>(aligned(reinterpret_cast<uintptr_t>(mem.data())));
+		memcpy(p, f.data(), f.size());
+		std::string_view s(p, f.size());
+
+		reader r(s);
+		ensure(r and r.source() == 0x1234 and r.rows() == 3 and r.size() == 4);
+		ensure(r.kind(0) == type::number and r.name(0) == "px" and r.doubles(0)[2] == 3.25);
+		ensure(reinterpret_cast<const int32_t*>(r.block(0))[0] == 3 and reinterpret_cast<const int32_t*>(r.block(0))[1] == 1);
+		ensure(r.kind(1) == type::integer and r.integers(1)[2] == 1LL << 40);
+		ensure(r.kind(2) == type::string and r.count(2) == 2 and r.word(2, r.codes(2)[2]) == "IBM" and r.word(2, 1) == "");
+		ensure(r.kind(3) == type::array and r.width(3) == 2 and r.doubles(3)[4] == 44202);
+		ensure(reinterpret_cast<uintptr_t>(r.block(3)) % align == 0);
+
+		ensure(!reader(s.substr(0, s.size() - 1)));
+		ensure(!reader(std::string_view(p + 1, 64)));
+		p[8] = 2; // version
+		ensure(!reader(s));
+		p[8] = 1;
+		ensure(reader(s));
+		const_cast<uint32_t*>(r.codes(2))[1] = 2; // not in dictionary
+		ensure(!reader(s));
+
+		writer empty(0, 0);
+		empty.doubles("", type::array, nullptr, 5);
+		auto g = empty.str();
+		memcpy(p, g.data(), g.size());
+		reader z(std::string_view(p, g.size()));
+		ensure(z and z.rows() == 0 and z.width(0) == 5);
+
+		return 0;
+	}
+
+#endif // _DEBUG
+
+} // namespace fms::columns
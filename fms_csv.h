@@ -0,0 +1,729 @@
+// fms_csv.h - comma separated values
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "fms_search.h"
+
+namespace fms::csv {
+
+	// Fields may be quoted with '"'. Quotes in quoted fields are doubled.
+	// The escape character makes the next character literal.
+	struct dialect {
+		char rs = '\n'; // record separator
+		char fs = ',';  // field separator
+		char esc = '\\'; // escape character
+		char quote = '"';
+	};
+
+	// Split record into fields. Fields keep their quotes.
+	inline std::vector<std::string_view>& split(std::string_view record, const dialect& d, std::vector<std::string_view>& fields)
+	{
+		fields.clear();
+
+		bool quoted = false;
+		size_t b = 0;
+		for (size_t i = 0; i < record.size(); ++i) {
+			char c = record[i];
+			if (c == d.esc and d.esc) {
+				++i;
+			}
+			else if (c == d.quote) {
+				quoted = !quoted;
+			}
+			else if (c == d.fs and !quoted) {
+				fields.push_back(record.substr(b, i - b));
+				b = i + 1;
+			}
+		}
+		fields.push_back(record.substr(b));
+
+		return fields;
+	}
+
+	// Remove quotes and escapes from field using s as scratch if needed.
+	inline std::string_view unquote(std::string_view field, const dialect& d, std::string& s)
+	{
+		if (field.find(d.quote) == field.npos and (!d.esc or field.find(d.esc) == field.npos)) {
+			return field;
+		}
+
+		s.clear();
+		bool quoted = false;
+		for (size_t i = 0; i < field.size(); ++i) {
+			char c = field[i];
+			if (c == d.esc and d.esc and i + 1 < field.size()) {
+				s.push_back(field[++i]);
+			}
+			else if (c == d.quote) {
+				if (quoted and i + 1 < field.size() and field[i + 1] == d.quote) {
+					s.push_back(d.quote);
+					++i;
+				}
+				else {
+					quoted = !quoted;
+				}
+			}
+			else {
+				s.push_back(c);
+			}
+		}
+
+		return s;
+	}
+
+	// Records from data arriving in chunks. Partial records are kept
+	// until the rest of the record arrives.
+	class stream {
+		dialect d;
+		std::string carry; // partial record
+		bool quoted = false; // quote state at end of carry
+		bool escaped = false; // escape at end of carry
+		bool done = false;
+
+		// strip "\r" from "\r\n" line endings
+		std::string_view record(std::string_view r) const
+		{
+			if (d.rs == '\n' and r.size() and r.back() == '\r') {
+				r.remove_suffix(1);
+			}
+
+			return r;
+		}
+	public:
+		stream(const dialect& d = dialect{})
+			: d(d)
+		{ }
+
+		// false after a callback returned false
+		bool is_done() const
+		{
+			return done;
+		}
+
+		// call f(record) for each complete record in chunk until f returns false
+		template<class F>
+		bool feed(std::string_view chunk, F&& f)
+		{
+			size_t b = 0; // start of record in chunk
+			for (size_t i = 0; i < chunk.size() and !done; ++i) {
+				char c = chunk[i];
+				if (escaped) {
+					escaped = false;
+				}
+				else if (c == d.esc and d.esc) {
+					escaped = true;
+				}
+				else if (c == d.quote) {
+					quoted = !quoted;
+				}
+				else if (c == d.rs and !quoted) {
+					if (carry.size()) {
+						carry.append(chunk.substr(b, i - b));
+						done = !f(record(carry));
+						carry.clear();
+					}
+					else {
+						done = !f(record(chunk.substr(b, i - b)));
+					}
+					b = i + 1;
+				}
+			}
+			if (!done) {
+				carry.append(chunk.substr(b));
+			}
+
+			return !done;
+		}
+
+		// call f on the last record if it has no record separator
+		template<class F>
+		void finish(F&& f)
+		{
+			if (!done and carry.size()) {
+				f(record(carry));
+			}
+			carry.clear();
+			done = true;
+		}
+	};
+
+	// Structural bitmasks of 64 characters at a time as in
+	// https://github.com/geofflangdale/simdcsv
+	namespace bits {
+
+		// bit i set if p[i] is a quote, escape, or separator
+		class classifier {
+#ifdef FMS_SEARCH_SIMD
+			fms::search::vector q, e, f, r;
+#endif
+			dialect d;
+		public:
+			classifier(const dialect& d)
+				: d(d)
+			{
+#ifdef FMS_SEARCH_SIMD
+				q = fms::search::splat(d.quote);
+				e = fms::search::splat(d.esc);
+				f = fms::search::splat(d.fs);
+				r = fms::search::splat(d.rs);
+#endif
+			}
+			void operator()(const char* p, uint64_t& quote, uint64_t& esc, uint64_t& sep) const
+			{
+				quote = esc = sep = 0;
+#ifdef FMS_SEARCH_SIMD
+				for (size_t k = 0; k < 64; k += fms::search::block) {
+					auto v = fms::search::load(p + k);
+					quote |= static_cast<uint64_t>(fms::search::eq(v, q)) << k;
+					esc |= static_cast<uint64_t>(fms::search::eq(v, e)) << k;
+					sep |= static_cast<uint64_t>(fms::search::eq(v, f) | fms::search::eq(v, r)) << k;
+				}
+#else
+				for (size_t k = 0; k < 64; ++k) {
+					uint64_t b = uint64_t(1) << k;
+					quote |= p[k] == d.quote ? b : 0;
+					esc |= p[k] == d.esc ? b : 0;
+					sep |= p[k] == d.fs or p[k] == d.rs ? b : 0;
+				}
+#endif
+				if (!d.esc) {
+					esc = 0;
+				}
+			}
+		};
+
+		// Bits of characters following an odd number of escapes.
+		// Carry is 1 if the last character of the previous block escapes the next one.
+		// https://github.com/simdjson/simdjson/blob/master/src/generic/stage1/json_escape_scanner.h
+		inline uint64_t escaped(uint64_t esc, uint64_t& carry)
+		{
+			constexpr uint64_t even = 0x5555555555555555;
+
+			esc &= ~carry;
+			uint64_t follows = (esc << 1) | carry;
+			uint64_t odd_starts = esc & ~even & ~follows;
+			uint64_t even_starts = odd_starts + esc;
+			carry = even_starts < odd_starts; // overflow
+			uint64_t invert = even_starts << 1;
+
+			return (even ^ invert) & follows;
+		}
+
+		// bit i is the xor of bits 0 to i
+		inline uint64_t prefix_xor(uint64_t x)
+		{
+			x ^= x << 1;
+			x ^= x << 2;
+			x ^= x << 4;
+			x ^= x << 8;
+			x ^= x << 16;
+			x ^= x << 32;
+
+			return x;
+		}
+
+	} // namespace bits
+
+	// tokenizer state at the start or end of a block
+	struct state {
+		bool quoted = false; // inside quotes
+		bool escaped = false; // next character is escaped
+	};
+
+	// Call f(e, last) for each separator at offset e of s that is not quoted or escaped
+	// where last is true for a record separator. Return the state at the end of s.
+	template<class F>
+	inline state separators(std::string_view s, const dialect& d, state st, F&& f)
+	{
+		const bits::classifier classify(d);
+		uint64_t carry = st.escaped; // last character was an unescaped escape
+		uint64_t quoted = st.quoted ? ~uint64_t(0) : 0; // all ones if the previous block ended inside quotes
+
+		char pad[64];
+		for (size_t i = 0; i < s.size(); i += 64) {
+			const char* p = s.data() + i;
+			uint64_t valid = ~uint64_t(0);
+			if (s.size() - i < 64) {
+				memcpy(pad, p, s.size() - i);
+				memset(pad + (s.size() - i), 0, 64 - (s.size() - i));
+				p = pad;
+				valid = (uint64_t(1) << (s.size() - i)) - 1;
+			}
+
+			uint64_t quote, esc, sep;
+			classify(p, quote, esc, sep);
+			esc = bits::escaped(esc & valid, carry);
+			if (~valid) {
+				carry = (esc >> (s.size() - i)) & 1; // escape at the end of s
+			}
+			uint64_t inside = bits::prefix_xor(quote & valid & ~esc) ^ quoted;
+			quoted = inside >> 63 ? ~uint64_t(0) : 0;
+
+			for (sep &= valid & ~inside & ~esc; sep; sep &= sep - 1) {
+				size_t e = i + std::countr_zero(sep);
+				f(e, s[e] == d.rs);
+			}
+		}
+
+		return state{ quoted != 0, carry != 0 };
+	}
+
+	// true if the last field of s has no record separator
+	inline bool unterminated(std::string_view s, const dialect& d, size_t b)
+	{
+		return b < s.size() or (b == s.size() and s.size() and s.back() != d.rs);
+	}
+
+	// Call f(begin, end, last) for each field of s in one pass where last is true
+	// for the last field of a record. The field is s.substr(begin, end - begin)
+	// with quotes and escapes left in and "\r" of "\r\n" removed.
+	template<class F>
+	inline void tokenize(std::string_view s, const dialect& d, F&& f)
+	{
+		size_t b = 0; // start of field
+
+		auto field = [&](size_t e, bool last) {
+			auto e_ = e;
+			if (last and d.rs == '\n' and e > b and s[e - 1] == '\r') {
+				--e_;
+			}
+			f(b, e_, last);
+			b = e + 1;
+		};
+
+		separators(s, d, state{}, field);
+		if (unterminated(s, d, b)) {
+			field(s.size(), true);
+		}
+	}
+
+	// Offset just past the first n records of s, or s.size() if s has fewer.
+	// Only record separators are found and scanning stops after the last one.
+	inline size_t skip(std::string_view s, const dialect& d, size_t n)
+	{
+		constexpr size_t block = 1 << 16;
+
+		if (n == 0) {
+			return 0;
+		}
+		dialect r = d;
+		r.fs = d.rs; // only classify record separators
+		state st;
+		size_t b = s.size();
+		for (size_t i = 0; i < s.size() and b == s.size(); i += block) {
+			st = separators(s.substr(i, block), r, st, [i, &n, &b](size_t e, bool) {
+				if (n and --n == 0) {
+					b = i + e + 1;
+				}
+			});
+		}
+
+		return b;
+	}
+
+	// Offsets of all fields of s. Large data is split into chunks at record
+	// separators that are tokenized in parallel assuming they start outside
+	// quotes. Quote parity is then propagated serially and any chunk
+	// that started inside a quoted field is tokenized again.
+	class index {
+		dialect d;
+		std::vector<size_t> ends; // separator after each field
+		std::vector<size_t> records; // first field of each record and the number of fields
+
+		// separators of s[b, e) and the number of fields before each record end
+		struct part {
+			size_t b, e;
+			state start, end;
+			std::vector<size_t> ends, records;
+
+			part(size_t b, size_t e)
+				: b(b), e(e)
+			{ }
+
+			void scan(std::string_view s, const dialect& d)
+			{
+				ends.clear();
+				records.clear();
+				end = separators(s.substr(b, e - b), d, start, [this](size_t i, bool last) {
+					ends.push_back(b + i);
+					if (last) {
+						records.push_back(ends.size());
+					}
+				});
+			}
+		};
+
+		// call f(k) for k in [0, n) on n threads
+		template<class F>
+		static void parallel(size_t n, F&& f)
+		{
+			if (n == 0) {
+				return;
+			}
+			std::vector<std::jthread> ts;
+			for (size_t k = 1; k < n; ++k) {
+				ts.emplace_back([&f, k]() { f(k); });
+			}
+			f(0);
+		}
+	public:
+		static constexpr size_t min_chunk = 1 << 20;
+
+		index(std::string_view s, const dialect& d = dialect{}, unsigned threads = 1)
+			: d(d)
+		{
+			if (threads > s.size() / min_chunk) {
+				threads = static_cast<unsigned>(s.size() / min_chunk);
+			}
+
+			// chunks start after a record separator
+			std::vector<part> parts(1, part{ 0, s.size() });
+			for (unsigned k = 1; k < threads; ++k) {
+				size_t b = s.size() * k / threads;
+				if (b < parts.back().b) {
+					continue;
+				}
+				auto p = static_cast<const char*>(memchr(s.data() + b, d.rs, s.size() - b));
+				if (!p or static_cast<size_t>(p + 1 - s.data()) >= s.size()) {
+					break;
+				}
+				parts.back().e = p + 1 - s.data();
+				parts.push_back(part{ parts.back().e, s.size() });
+			}
+
+			parallel(parts.size(), [&](size_t k) { parts[k].scan(s, d); });
+
+			// fix chunks that started inside quotes
+			std::vector<size_t> wrong;
+			for (size_t k = 1; k < parts.size(); ++k) {
+				bool quoted = parts[k - 1].end.quoted;
+				if (parts[k].start.quoted != quoted) {
+					// quote parity of a chunk does not depend on its start
+					parts[k].start.quoted = quoted;
+					parts[k].end.quoted = !parts[k].end.quoted;
+					wrong.push_back(k);
+				}
+			}
+			parallel(wrong.size(), [&](size_t k) { parts[wrong[k]].scan(s, d); });
+
+			// stitch
+			size_t n = 0, m = 0;
+			std::vector<std::pair<size_t, size_t>> at; // start of each part in ends and records
+			for (const auto& p : parts) {
+				at.emplace_back(n, m);
+				n += p.ends.size();
+				m += p.records.size();
+			}
+			ends.resize(n);
+			records.resize(m + 1);
+			records[0] = 0;
+			parallel(parts.size(), [&](size_t k) {
+				const auto& p = parts[k];
+				std::copy(p.ends.begin(), p.ends.end(), ends.begin() + at[k].first);
+				for (size_t i = 0; i < p.records.size(); ++i) {
+					records[at[k].second + i + 1] = p.records[i] + at[k].first;
+				}
+			});
+			if (unterminated(s, d, ends.empty() ? 0 : ends.back() + 1)) {
+				ends.push_back(s.size());
+				records.push_back(ends.size());
+			}
+		}
+
+		// number of records
+		size_t size() const
+		{
+			return records.size() - 1;
+		}
+		// number of fields in record r
+		size_t fields(size_t r) const
+		{
+			return records[r + 1] - records[r];
+		}
+		// offset of the separator ending record r, or s.size() if the last record has none
+		size_t end(size_t r) const
+		{
+			return ends[records[r + 1] - 1];
+		}
+		// field j of record r without "\r" of "\r\n"
+		std::string_view field(std::string_view s, size_t r, size_t j) const
+		{
+			auto k = records[r] + j;
+			auto b = k ? ends[k - 1] + 1 : 0;
+			auto e = ends[k];
+			if (j + 1 == fields(r) and d.rs == '\n' and e > b and s[e - 1] == '\r') {
+				--e;
+			}
+
+			return s.substr(b, e - b);
+		}
+	};
+
+	// counts of each character of c in s
+	template<size_t N>
+	inline void histogram(std::string_view s, const char (&c)[N], size_t (&n)[N])
+	{
+		std::fill(n, n + N, 0);
+		size_t i = 0;
+#ifdef FMS_SEARCH_SIMD
+		fms::search::vector v[N];
+		for (size_t k = 0; k < N; ++k) {
+			v[k] = fms::search::splat(c[k]);
+		}
+		for (; i + fms::search::block <= s.size(); i += fms::search::block) {
+			auto x = fms::search::load(s.data() + i);
+			for (size_t k = 0; k < N; ++k) {
+				n[k] += std::popcount(fms::search::eq(x, v[k]));
+			}
+		}
+#endif
+		for (; i < s.size(); ++i) {
+			for (size_t k = 0; k < N; ++k) {
+				n[k] += s[i] == c[k];
+			}
+		}
+	}
+
+	// dialect and layout of CSV data
+	struct sniffed {
+		dialect d;
+		bool header = false; // first record has column names
+		bool crlf = false; // records end in "\r\n"
+	};
+
+	// looks like a number or date
+	inline bool numeric(std::string_view f)
+	{
+		while (f.size() and f.front() == ' ') {
+			f.remove_prefix(1);
+		}
+		if (f.size() and (f.front() == '-' or f.front() == '+')) {
+			f.remove_prefix(1);
+		}
+		if (f.size() and f.front() == '.') {
+			f.remove_prefix(1);
+		}
+
+		return f.size() and '0' <= f.front() and f.front() <= '9';
+	}
+
+	// Infer the dialect of s from the whole records in its first sample bytes.
+	// Character counts pick the record separator and the candidate field separators
+	// and quotes. The candidate that splits the most records into the same number
+	// of at least two fields wins and ties go to the one with more fields. The first record is a header if its fields are
+	// not numeric in columns that are mostly numeric below it.
+	inline sniffed sniff(std::string_view s, size_t sample = 1 << 14)
+	{
+		sniffed result;
+		auto& d = result.d;
+
+		if (s.size() > sample) {
+			auto e = s.substr(0, sample).rfind('\n');
+			s = s.substr(0, e != s.npos and e > 0 ? e + 1 : sample);
+		}
+
+		enum { lf, cr, comma, tab, semicolon, pipe, dquote, squote, backslash };
+		static constexpr char c[] = { '\n', '\r', ',', '\t', ';', '|', '"', '\'', '\\' };
+		size_t n[std::size(c)];
+		histogram(s, c, n);
+
+		d.rs = n[lf] or !n[cr] ? '\n' : '\r';
+		result.crlf = n[lf] and fms::search::count(s, "\r\n") * 10 >= n[lf] * 9;
+
+		// backslashes that are not followed by a special character are not escapes
+		d.esc = 0;
+		if (n[backslash]) {
+			fms::search::each(s, '\\', [&](size_t i) {
+				if (i + 1 < s.size() and std::string_view("\n\r,\t;|\"'\\").find(s[i + 1]) != std::string_view::npos) {
+					d.esc = '\\';
+				}
+			});
+		}
+		else {
+			d.esc = dialect{}.esc;
+		}
+
+		double best = 0; // fraction of records having the most common number of fields
+		size_t most = 0; // fields of the best candidate
+		for (int k : { comma, tab, semicolon, pipe }) {
+			if (!n[k]) {
+				continue;
+			}
+			for (int q : { dquote, squote }) {
+				if (q == squote and !n[squote]) {
+					continue;
+				}
+				dialect t{ d.rs, c[k], d.esc, c[q] };
+				index ix(s, t);
+				std::map<size_t, size_t> count; // of records having fields
+				for (size_t r = 0; r < ix.size(); ++r) {
+					++count[ix.fields(r)];
+				}
+				for (auto [fields, records] : count) {
+					double score = fields < 2 ? 0 : static_cast<double>(records) / ix.size();
+					if (score > best or (score == best and score and fields > most)) {
+						best = score;
+						most = fields;
+						d.fs = t.fs;
+						d.quote = t.quote;
+					}
+				}
+			}
+		}
+
+		index ix(s, d);
+		if (ix.size() > 1) {
+			std::string tmp;
+			int votes = 0;
+			for (size_t j = 0; j < ix.fields(0); ++j) {
+				size_t rows = 0, numbers = 0;
+				for (size_t r = 1; r < ix.size() and r <= 100; ++r) {
+					if (j < ix.fields(r)) {
+						++rows;
+						numbers += numeric(unquote(ix.field(s, r, j), d, tmp));
+					}
+				}
+				if (numeric(unquote(ix.field(s, 0, j), d, tmp))) {
+					--votes;
+				}
+				else if (2 * numbers >= rows and numbers) {
+					++votes;
+				}
+			}
+			if (votes == 0) {
+				// all strings: a header has at least two distinct nonempty names
+				std::vector<std::string> names;
+				for (size_t j = 0; j < ix.fields(0); ++j) {
+					names.emplace_back(unquote(ix.field(s, 0, j), d, tmp));
+				}
+				std::sort(names.begin(), names.end());
+				votes = names.size() > 1 and !names.front().empty() and std::adjacent_find(names.begin(), names.end()) == names.end();
+			}
+			result.header = votes > 0;
+		}
+
+		return result;
+	}
+
+#ifdef _DEBUG
+
+	inline int test()
+	{
+		{
+			auto is = [](std::string_view s, char rs, char fs, char esc, char quote, bool header, bool crlf) {
+				auto t = sniff(s);
+				return t.d.rs == rs and t.d.fs == fs and t.d.esc == esc and t.d.quote == quote and t.header == header and t.crlf == crlf;
+			};
+			ensure(is("a,b\n1,2\n3,4\n", '\n', ',', '\\', '"', true, false));
+			ensure(is("1;2,5;x\r\n3;4,5;y\r\n", '\n', ';', '\\', '"', false, true));
+			ensure(is("name\tpath\nx\tC:\\dir\\f\ny\tC:\\g\n", '\n', '\t', 0, '"', true, false));
+			ensure(is("a|b\r'x|y'|2\r", '\r', '|', '\\', '\'', true, false));
+			ensure(is("date,px\n\"2021-01-04\",\"1,5\"\n2021-01-05,2\n", '\n', ',', '\\', '"', true, false));
+			ensure(is("x\ny\n", '\n', ',', '\\', '"', false, false));
+			std::string big;
+			for (int i = 0; i < 10000; ++i) {
+				big.append(std::to_string(i)).append(";").append(std::to_string(i * 3)).append("\n");
+			}
+			ensure(is(big, '\n', ';', '\\', '"', false, false));
+		}
+		{
+			dialect d;
+			std::string_view s("a,\"b\nc\"\nd\\\ne\nf");
+			ensure(skip(s, d, 0) == 0);
+			ensure(skip(s, d, 1) == 8);
+			ensure(skip(s, d, 2) == 13);
+			ensure(skip(s, d, 3) == s.size());
+			std::string big;
+			for (size_t i = 0; big.size() < 300000; ++i) {
+				big.append("\"x\ny\",").append(std::to_string(i)).append("\n");
+			}
+			index ix(big, d);
+			for (size_t n : { 1, 1000, 20000 }) {
+				auto e = skip(big, d, n);
+				ensure(e == static_cast<size_t>(ix.field(big, n - 1, 1).data() + ix.field(big, n - 1, 1).size() + 1 - big.data()));
+			}
+		}
+		// records and fields from tokenize agree with split
+		auto check = [](std::string_view s, const dialect& d) {
+			std::vector<std::string> a, b;
+			tokenize(s, d, [&](size_t i, size_t j, bool last) {
+				a.emplace_back(s.substr(i, j - i)).append(last ? "|" : "");
+			});
+			std::vector<std::string_view> fields;
+			stream r(d);
+			auto f = [&](std::string_view rec) {
+				for (auto field : split(rec, d, fields)) {
+					b.emplace_back(field);
+				}
+				b.back().append("|");
+				return true;
+			};
+			r.feed(s, f);
+			r.finish(f);
+			ensure(a == b);
+		};
+
+		dialect d;
+		check("", d);
+		check("a", d);
+		check("a,b\r\n,\n\"x,\"\"\ny\",z", d);
+		check("a\\,b,\"c\\\"d,e\",f\\\\,g\n", d);
+		check("\n\n,", d);
+
+		// random data crossing 64 character blocks
+		std::string s;
+		const char cs[] = "ab,\"\\\n\r";
+		for (uint32_t i = 0, x = 1; i < 5000; ++i) {
+			x = x * 1103515245 + 12345;
+			s.push_back(cs[(x >> 16) % (sizeof(cs) - 1)]);
+		}
+		for (size_t n : { 1u, 63u, 64u, 65u, 1000u, 5000u }) {
+			check(std::string_view(s).substr(0, n), d);
+			check(std::string_view(s).substr(5000 - n), d);
+		}
+		dialect t{ '\n', '\t', 0, '"' };
+		check("a\tb\\\tc\n\"d\te\"", t);
+
+		// state carries across blocks split anywhere
+		for (size_t n : { 1u, 7u, 63u, 64u, 100u, 2500u }) {
+			std::vector<size_t> a, b;
+			separators(s, d, state{}, [&a](size_t e, bool) { a.push_back(e); });
+			state st;
+			for (size_t i = 0; i < s.size(); i += n) {
+				st = separators(std::string_view(s).substr(i, n), d, st, [&b, i](size_t e, bool) { b.push_back(i + e); });
+			}
+			ensure(a == b);
+		}
+
+		// chunks tokenized in parallel give the same index
+		std::string big;
+		for (int i = 0; big.size() < 5 * index::min_chunk; ++i) {
+			big.append(std::to_string(i)).append(i % 3 ? ",x\\\r\n" : ",\"multi\nline \"\"\\\"\n\"\n");
+		}
+		index i1(big, d), i4(big, d, 4);
+		ensure(i1.size() == i4.size());
+		for (size_t r = 0; r < i1.size(); r += 997) {
+			ensure(i1.fields(r) == i4.fields(r) and i1.field(big, r, 1) == i4.field(big, r, 1));
+		}
+		ensure(i4.field(big, 3, 1) == "\"multi\nline \"\"\\\"\n\"");
+
+		index ix("a,b\r\n1,\"x,y\",3\n4", d);
+		ensure(ix.size() == 3);
+		ensure(ix.fields(0) == 2 and ix.fields(1) == 3 and ix.fields(2) == 1);
+		ensure(ix.field("a,b\r\n1,\"x,y\",3\n4", 1, 1) == "\"x,y\"");
+		ensure(ix.field("a,b\r\n1,\"x,y\",3\n4", 0, 1) == "b");
+
+		return 0;
+	}
+
+#endif // _DEBUG
+
+} // namespace fms::csv
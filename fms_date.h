@@ -0,0 +1,243 @@
+// fms_date.h - parse dates to Excel serial numbers
+// http://howardhinnant.github.io/date_algorithms.html
+#pragma once
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+namespace fms::date {
+
+	// days since 1970-01-01 of the proleptic Gregorian date y-m-d
+	constexpr int64_t days_from_civil(int64_t y, unsigned m, unsigned d)
+	{
+		y -= m <= 2;
+		const int64_t era = (y >= 0 ? y : y - 399) / 400;
+		const unsigned yoe = static_cast<unsigned>(y - era * 400); // [0, 399]
+		const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1; // [0, 365]
+		const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy; // [0, 146096]
+
+		return era * 146097 + static_cast<int64_t>(doe) - 719468;
+	}
+
+	constexpr bool is_leap(int64_t y)
+	{
+		return y % 4 == 0 and (y % 100 != 0 or y % 400 == 0);
+	}
+
+	constexpr unsigned days_in_month(int64_t y, unsigned m)
+	{
+		constexpr unsigned n[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+		return m == 2 and is_leap(y) ? 29 : n[m - 1];
+	}
+
+	// Excel dates are 1900-01-01 through 9999-12-31
+	constexpr bool valid(int64_t y, unsigned m, unsigned d)
+	{
+		return 1900 <= y and y <= 9999 and 1 <= m and m <= 12 and 1 <= d and d <= days_in_month(y, m);
+	}
+
+	constexpr double epoch = 25569; // 1970-01-01
+
+	// Excel serial number of y-m-d. Excel treats 1900 as a leap year so
+	// 1900-03-01 is 61 and 1900-02-28 is 59.
+	constexpr double excel(int64_t y, unsigned m, unsigned d)
+	{
+		auto n = days_from_civil(y, m, d) - days_from_civil(1899, 12, 30);
+
+		return static_cast<double>(n < 61 ? n - 1 : n);
+	}
+
+	static_assert(excel(1900, 1, 1) == 1);
+	static_assert(excel(1900, 2, 28) == 59);
+	static_assert(excel(1900, 3, 1) == 61);
+	static_assert(excel(1970, 1, 1) == epoch);
+	static_assert(excel(9999, 12, 31) == 2958465);
+
+	// digits of s as an unsigned number
+	inline bool digits(std::string_view s, unsigned& n)
+	{
+		auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), n);
+
+		return s.size() and s[0] != '-' and ec == std::errc{} and ptr == s.data() + s.size();
+	}
+
+	// Eight ASCII digits at p as two digit numbers in each byte pair using SWAR.
+	// Returns false if they are not all digits.
+	inline bool pairs(const char* p, uint64_t& v)
+	{
+		memcpy(&v, p, sizeof(v)); // little-endian: first character is the low byte
+		if (((v & 0xF0F0F0F0F0F0F0F0) | (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) != 0x3333333333333333) {
+			return false;
+		}
+		v -= 0x3030303030303030;
+		v = v * 10 + (v >> 8); // byte 2k is 10 d[2k] + d[2k + 1]
+
+		return true;
+	}
+
+	// "yyyymmdd"
+	inline bool compact(const char* p, double& x)
+	{
+		uint64_t v;
+		if (!pairs(p, v)) {
+			return false;
+		}
+		auto y = (v & 0xFF) * 100 + ((v >> 16) & 0xFF);
+		auto m = static_cast<unsigned>((v >> 32) & 0xFF);
+		auto d = static_cast<unsigned>((v >> 48) & 0xFF);
+		if (!valid(y, m, d)) {
+			return false;
+		}
+		x = excel(y, m, d);
+
+		return true;
+	}
+
+	// fixed width "yyyy-mm-dd" or "yyyy/mm/dd"
+	inline bool iso(const char* p, double& x)
+	{
+		if (p[4] != p[7] or (p[4] != '-' and p[4] != '/')) {
+			return false;
+		}
+		char b[8] = { p[0], p[1], p[2], p[3], p[5], p[6], p[8], p[9] };
+
+		return compact(b, x);
+	}
+
+	// "hh:mm", "hh:mm:ss", or "hh:mm:ss.fff" as a fraction of a day
+	inline bool time(std::string_view s, double& x)
+	{
+		unsigned h, m, sec = 0;
+		double frac = 0;
+		if (s.size() < 5 or s[2] != ':' or !digits(s.substr(0, 2), h) or !digits(s.substr(3, 2), m)) {
+			return false;
+		}
+		s.remove_prefix(5);
+		if (s.size()) {
+			if (s.size() < 3 or s[0] != ':' or !digits(s.substr(1, 2), sec)) {
+				return false;
+			}
+			s.remove_prefix(3);
+			if (s.size()) {
+				unsigned f;
+				if (s[0] != '.' or s.size() == 1 or s.size() > 10 or !digits(s.substr(1), f)) {
+					return false;
+				}
+				frac = f;
+				for (size_t i = 1; i < s.size(); ++i) {
+					frac /= 10;
+				}
+			}
+		}
+		if (h > 23 or m > 59 or sec > 59) {
+			return false;
+		}
+		x = (h * 3600 + m * 60 + sec + frac) / 86400;
+
+		return true;
+	}
+
+	// Parse s to an Excel date. Formats are "yyyy-mm-dd" optionally followed by
+	// 'T' or ' ' and a time with an optional 'Z', "yyyymmdd", and Unix epoch
+	// seconds (9 or 10 digits) or milliseconds (12 or 13 digits).
+	inline bool parse(std::string_view s, double& x)
+	{
+		if (s.size() >= 10 and (s[4] == '-' or s[4] == '/')) {
+			if (!iso(s.data(), x)) {
+				return false;
+			}
+			s.remove_prefix(10);
+			if (s.empty()) {
+				return true;
+			}
+			if (s[0] != 'T' and s[0] != ' ') {
+				return false;
+			}
+			s.remove_prefix(1);
+			if (s.size() and s.back() == 'Z') {
+				s.remove_suffix(1);
+			}
+			double t;
+			if (!time(s, t)) {
+				return false;
+			}
+			x += t;
+
+			return true;
+		}
+
+		if (s.size() == 8) {
+			return compact(s.data(), x);
+		}
+
+		uint64_t n;
+		auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), n);
+		if (ec != std::errc{} or ptr != s.data() + s.size() or s[0] == '-') {
+			return false;
+		}
+		if (s.size() == 9 or s.size() == 10) {
+			x = epoch + n / 86400.;
+		}
+		else if (s.size() == 12 or s.size() == 13) {
+			x = epoch + n / 86400000.;
+		}
+		else {
+			return false;
+		}
+
+		return true;
+	}
+
+#ifdef _DEBUG
+
+	inline int test()
+	{
+		// count days the way Excel does from 1900-01-01 = 1 including 1900-02-29 = 60
+		double serial = 1;
+		char buf[32];
+		for (int y = 1900; y <= 2100; ++y) {
+			for (unsigned m = 1; m <= 12; ++m) {
+				auto n = days_in_month(y, m);
+				for (unsigned d = 1; d <= n; ++d) {
+					ensure(excel(y, m, d) == serial);
+					double x;
+					auto l = snprintf(buf, sizeof(buf), "%04d-%02u-%02u", y, m, d);
+					ensure(parse(std::string_view(buf, l), x) and x == serial);
+					l = snprintf(buf, sizeof(buf), "%04d%02u%02u", y, m, d);
+					ensure(parse(std::string_view(buf, l), x) and x == serial);
+					++serial;
+				}
+				if (y == 1900 and m == 2) {
+					++serial; // 1900-02-29
+				}
+			}
+		}
+
+		double x;
+		ensure(parse("2021/01/02", x) and x == 44198);
+		ensure(parse("2021-01-02T12:00:00Z", x) and x == 44198.5);
+		ensure(parse("2021-01-02 06:00", x) and x == 44198.25);
+		ensure(parse("2021-01-02 00:00:00.5", x) and x == 44198 + .5 / 86400);
+		ensure(parse("1609545600", x) and x == 44198);
+		ensure(parse("1609588800000", x) and x == 44198.5);
+		ensure(!parse("2021-02-29", x));
+		ensure(!parse("2021-13-01", x));
+		ensure(!parse("2021-01-00", x));
+		ensure(!parse("2021-01/02", x));
+		ensure(!parse("2021-0a-02", x));
+		ensure(!parse("1899-12-31", x));
+		ensure(!parse("2021-01-02x", x));
+		ensure(!parse("2021-01-02 24:00", x));
+		ensure(!parse("20210230", x));
+		ensure(!parse("12.5", x));
+		ensure(!parse("", x));
+
+		return 0;
+	}
+
+#endif // _DEBUG
+
+} // namespace fms::date
@@ -0,0 +1,110 @@
+// fms_hash.h - fast 64-bit hash of data arriving in pieces
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace fms::hash {
+
+	constexpr uint64_t k1 = 0x9E3779B97F4A7C15;
+	constexpr uint64_t k2 = 0xC2B2AE3D27D4EB4F;
+
+	// final avalanche from MurmurHash3
+	constexpr uint64_t mix(uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCD;
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53;
+		h ^= h >> 33;
+
+		return h;
+	}
+
+	// Hash of the bytes given to update so far. The hash does not
+	// depend on how the bytes are split between calls.
+	class digest {
+		uint64_t h;
+		uint64_t n = 0; // bytes so far
+		char pending[8]; // bytes of an incomplete word
+
+		void word(uint64_t w)
+		{
+			h = std::rotl(h ^ (w * k1), 31) * k2;
+		}
+	public:
+		digest(uint64_t seed = 0)
+			: h(seed)
+		{ }
+
+		digest& update(std::string_view s)
+		{
+			size_t i = 0;
+			size_t m = n % 8;
+			n += s.size();
+			if (m) {
+				i = s.size() < 8 - m ? s.size() : 8 - m;
+				memcpy(pending + m, s.data(), i);
+				if (m + i < 8) {
+					return *this;
+				}
+				uint64_t w;
+				memcpy(&w, pending, 8);
+				word(w);
+			}
+			for (; i + 8 <= s.size(); i += 8) {
+				uint64_t w;
+				memcpy(&w, s.data() + i, 8);
+				word(w);
+			}
+			memcpy(pending, s.data() + i, s.size() - i);
+
+			return *this;
+		}
+
+		// number of bytes hashed
+		uint64_t size() const
+		{
+			return n;
+		}
+
+		uint64_t value() const
+		{
+			uint64_t w = 0;
+			memcpy(&w, pending, n % 8);
+
+			return mix(h ^ (w * k2) ^ n);
+		}
+	};
+
+	inline uint64_t of(std::string_view s, uint64_t seed = 0)
+	{
+		return digest(seed).update(s).value();
+	}
+
+#ifdef _DEBUG
+
+	inline int test()
+	{
+		std::string_view s("The quick brown fox jumps over the lazy dog.");
+		auto h = of(s);
+		for (size_t i = 0; i <= s.size(); ++i) {
+			for (size_t j = i; j <= s.size(); ++j) {
+				digest d;
+				d.update(s.substr(0, i)).update(s.substr(i, j - i)).update(s.substr(j));
+				ensure(d.value() == h);
+				ensure(d.size() == s.size());
+			}
+		}
+		ensure(of("") != of(std::string_view("\0", 1)));
+		ensure(of("a") != of("b"));
+		ensure(of("ab") != of("ba"));
+		ensure(of(s, 1) != h);
+
+		return 0;
+	}
+
+#endif // _DEBUG
+
+} // namespace fms::hash
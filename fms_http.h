@@ -0,0 +1,129 @@
+// fms_http.h - HTTP response headers
+#pragma once
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fms::http {
+
+	// ASCII lower case for case insensitive header names
+	inline std::string lower(std::string_view s)
+	{
+		std::string l(s);
+
+		for (auto& c : l) {
+			if ('A' <= c and c <= 'Z') {
+				c += 'a' - 'A';
+			}
+		}
+
+		return l;
+	}
+
+	inline std::string_view trim(std::string_view s)
+	{
+		while (s.size() and (s.front() == ' ' or s.front() == '\t')) {
+			s.remove_prefix(1);
+		}
+		while (s.size() and (s.back() == ' ' or s.back() == '\t')) {
+			s.remove_suffix(1);
+		}
+
+		return s;
+	}
+
+	// Raw header block parsed once into name/value fields.
+	// "HTTP/1.1 200 OK\r\nName: value\r\n...\r\n\r\n"
+	class headers {
+		std::string status_;
+		std::vector<std::pair<std::string, std::string>> fields_;
+		// lower case name to indices of fields_
+		std::unordered_map<std::string, std::vector<size_t>> index_;
+	public:
+		headers() = default;
+		headers(std::string_view raw)
+		{
+			bool first = true;
+			while (raw.size()) {
+				auto eol = raw.find('\n');
+				auto line = raw.substr(0, eol);
+				raw.remove_prefix(eol == raw.npos ? raw.size() : eol + 1);
+				if (line.size() and line.back() == '\r') {
+					line.remove_suffix(1);
+				}
+				if (line.empty()) {
+					continue;
+				}
+
+				if (first and line.starts_with("HTTP/")) {
+					status_ = line;
+				}
+				else if (line.front() == ' ' or line.front() == '\t') {
+					// obsolete line folding
+					if (fields_.size()) {
+						fields_.back().second.append(" ").append(trim(line));
+					}
+				}
+				else if (auto colon = line.find(':'); colon != line.npos) {
+					auto name = trim(line.substr(0, colon));
+					index_[lower(name)].push_back(fields_.size());
+					fields_.emplace_back(name, trim(line.substr(colon + 1)));
+				}
+				first = false;
+			}
+		}
+
+		// status line, e.g., "HTTP/1.1 200 OK"
+		const std::string& status() const
+		{
+			return status_;
+		}
+		// name and value in the order received
+		const std::vector<std::pair<std::string, std::string>>& fields() const
+		{
+			return fields_;
+		}
+		size_t size() const
+		{
+			return fields_.size();
+		}
+
+		// number of fields having name
+		size_t count(std::string_view name) const
+		{
+			auto i = index_.find(lower(name));
+
+			return i == index_.end() ? 0 : i->second.size();
+		}
+		// n-th value of header name or nullptr if not found
+		const std::string* find(std::string_view name, size_t n = 0) const
+		{
+			auto i = index_.find(lower(name));
+			if (i == index_.end() or n >= i->second.size()) {
+				return nullptr;
+			}
+
+			return &fields_[i->second[n]].second;
+		}
+		// all values of name joined by ", " as per RFC 7230 section 3.2.2
+		std::string value(std::string_view name) const
+		{
+			std::string v;
+
+			auto i = index_.find(lower(name));
+			if (i != index_.end()) {
+				for (auto j : i->second) {
+					if (v.size()) {
+						v.append(", ");
+					}
+					v.append(fields_[j].second);
+				}
+			}
+
+			return v;
+		}
+	};
+
+} // namespace fms::http
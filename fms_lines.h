@@ -0,0 +1,116 @@
+// fms_lines.h - line offset index
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "fms_search.h"
+
+namespace fms {
+
+	// Offsets of the start of each line found by one vectorized scan for '\n'.
+	// Every stride lines store the absolute offset and 32-bit deltas from it
+	// for the others so lookup is O(1) at about 4 bytes per line.
+	class lines {
+		static constexpr size_t stride = 256;
+		std::vector<size_t> base; // offset of line k * stride
+		std::vector<uint32_t> delta; // offset of line n - base[n / stride]
+		size_t len = 0;
+
+		void push(size_t off)
+		{
+			if (delta.size() % stride == 0) {
+				base.push_back(off);
+			}
+			ensure(off - base.back() <= UINT32_MAX || !__FUNCTION__ ": lines too long to index");
+			delta.push_back(static_cast<uint32_t>(off - base.back()));
+		}
+	public:
+		lines() = default;
+		lines(std::string_view s)
+			: len(s.size())
+		{
+			push(0);
+			search::each(s, '\n', [this](size_t i) { push(i + 1); });
+			// no empty line after a final newline
+			if (offset(delta.size() - 1) == len) {
+				delta.pop_back();
+				if (delta.size() % stride == 0) {
+					base.pop_back();
+				}
+			}
+		}
+
+		// number of lines
+		size_t size() const
+		{
+			return delta.size();
+		}
+		// offset of the start of line n
+		size_t offset(size_t n) const
+		{
+			return base[n / stride] + delta[n];
+		}
+		// line n of s without the line ending
+		std::string_view line(std::string_view s, size_t n) const
+		{
+			auto b = offset(n);
+			auto e = n + 1 < size() ? offset(n + 1) - 1 : len;
+			auto l = s.substr(b, e - b);
+			if (l.size() and l.back() == '\n') {
+				l.remove_suffix(1);
+			}
+			if (l.size() and l.back() == '\r') {
+				l.remove_suffix(1);
+			}
+
+			return l;
+		}
+		// index memory use in bytes
+		size_t bytes() const
+		{
+			return base.size() * sizeof(size_t) + delta.size() * sizeof(uint32_t);
+		}
+	};
+
+#ifdef _DEBUG
+
+	inline int lines_test()
+	{
+		{
+			std::string_view s("");
+			lines l(s);
+			ensure(l.size() == 0);
+		}
+		{
+			std::string_view s("a\r\nbc\n\nd");
+			lines l(s);
+			ensure(l.size() == 4);
+			ensure(l.line(s, 0) == "a");
+			ensure(l.line(s, 1) == "bc");
+			ensure(l.line(s, 2) == "");
+			ensure(l.line(s, 3) == "d");
+		}
+		{
+			std::string s;
+			for (size_t i = 0; i < 1000; ++i) {
+				s.append(std::to_string(i)).append("\n");
+			}
+			lines l(s);
+			ensure(l.size() == 1000);
+			for (size_t i = 0; i < 1000; ++i) {
+				ensure(l.line(s, i) == std::to_string(i));
+			}
+		}
+		{
+			std::string s(2 * 256, '\n');
+			lines l(s);
+			ensure(l.size() == 512);
+			ensure(l.line(s, 511) == "");
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+
+} // namespace fms
@@ -0,0 +1,210 @@
+// fms_lz.h - fast LZ77 compression using the LZ4 block format
+// https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fms::lz {
+
+	constexpr size_t min_match = 4;
+	constexpr size_t last_literals = 5; // the block ends with at least this many literals
+	constexpr size_t match_limit = 12; // no match starts in the last 12 bytes
+	constexpr size_t max_offset = 65535;
+	constexpr int hash_log = 14;
+
+	// upper bound on the compressed size of n bytes
+	constexpr size_t bound(size_t n)
+	{
+		return n + n / 255 + 16;
+	}
+
+	inline uint32_t load32(const char* p)
+	{
+		uint32_t u;
+		memcpy(&u, p, sizeof(u));
+
+		return u;
+	}
+
+	inline uint32_t hash(uint32_t u)
+	{
+		return (u * 2654435761u) >> (32 - hash_log);
+	}
+
+	// length of 15 or more continued in bytes of 255
+	inline void append_length(std::string& out, size_t n)
+	{
+		for (; n >= 255; n -= 255) {
+			out.push_back('\xFF');
+		}
+		out.push_back(static_cast<char>(n));
+	}
+
+	// literals followed by a match of length m at offset back, m = 0 for the last sequence
+	inline void append_sequence(std::string& out, std::string_view literals, size_t offset, size_t m)
+	{
+		size_t l = literals.size();
+		size_t k = m ? m - min_match : 0;
+		out.push_back(static_cast<char>(((l < 15 ? l : 15) << 4) | (k < 15 ? k : 15)));
+		if (l >= 15) {
+			append_length(out, l - 15);
+		}
+		out.append(literals);
+		if (m) {
+			out.push_back(static_cast<char>(offset & 0xFF));
+			out.push_back(static_cast<char>(offset >> 8));
+			if (k >= 15) {
+				append_length(out, k - 15);
+			}
+		}
+	}
+
+	// compressed block of s
+	inline std::string compress(std::string_view s)
+	{
+		std::string out;
+		out.reserve(bound(s.size()));
+
+		const char* p = s.data();
+		const size_t n = s.size();
+		size_t anchor = 0; // start of pending literals
+
+		if (n > match_limit) {
+			std::vector<uint32_t> table(1 << hash_log, 0); // last position having hash
+			const size_t limit = n - match_limit;
+			size_t i = 0;
+			while (i < limit) {
+				auto u = load32(p + i);
+				auto& t = table[hash(u)];
+				size_t j = t;
+				t = static_cast<uint32_t>(i);
+				if (j >= i or i - j > max_offset or load32(p + j) != u) {
+					i += 1 + ((i - anchor) >> 6); // skip faster through incompressible data
+					continue;
+				}
+				while (i > anchor and j > 0 and p[i - 1] == p[j - 1]) {
+					--i;
+					--j;
+				}
+				size_t m = min_match;
+				while (i + m < n - last_literals and p[i + m] == p[j + m]) {
+					++m;
+				}
+				append_sequence(out, s.substr(anchor, i - anchor), i - j, m);
+				i += m;
+				anchor = i;
+				if (i < limit) {
+					table[hash(load32(p + i - 2))] = static_cast<uint32_t>(i - 2);
+				}
+			}
+		}
+		append_sequence(out, s.substr(anchor), 0, 0);
+
+		return out;
+	}
+
+	// Decompress block into out having room for len bytes.
+	// Return the number of bytes written or npos if the block is corrupt.
+	inline size_t decompress(std::string_view block, char* out, size_t len)
+	{
+		constexpr size_t npos = std::string_view::npos;
+		const auto* in = reinterpret_cast<const unsigned char*>(block.data());
+		const size_t n = block.size();
+		size_t i = 0, j = 0;
+
+		auto length = [in, n, &i](size_t l) {
+			if (l == 15) {
+				unsigned char b;
+				do {
+					if (i == n) {
+						return npos;
+					}
+					b = in[i++];
+					l += b;
+				} while (b == 255);
+			}
+			return l;
+		};
+
+		while (i < n) {
+			auto token = in[i++];
+			size_t l = length(token >> 4);
+			if (l > n - i or l > len - j) {
+				return npos;
+			}
+			memcpy(out + j, in + i, l);
+			i += l;
+			j += l;
+			if (i == n) {
+				break; // last sequence has no match
+			}
+			if (n - i < 2) {
+				return npos;
+			}
+			size_t offset = in[i] | (in[i + 1] << 8);
+			i += 2;
+			size_t m = length(token & 0xF);
+			if (m == npos or offset == 0 or offset > j or m + min_match > len - j) {
+				return npos;
+			}
+			m += min_match;
+			if (offset >= m) {
+				memcpy(out + j, out + j - offset, m);
+			}
+			else {
+				// overlapping copy repeats the last offset bytes
+				for (size_t k = 0; k < m; ++k) {
+					out[j + k] = out[j + k - offset];
+				}
+			}
+			j += m;
+		}
+
+		return j;
+	}
+
+#ifdef _DEBUG
+
+	inline int test()
+	{
+		auto round_trip = [](std::string_view s) {
+			auto c = compress(s);
+			ensure(c.size() <= bound(s.size()));
+			std::string d(s.size(), 0);
+			ensure(decompress(c, d.data(), d.size()) == s.size());
+			ensure(d == s);
+			return c.size();
+		};
+
+		round_trip("");
+		round_trip("a");
+		round_trip("abcdefghijklm");
+		ensure(round_trip(std::string(1000, 'a')) < 20);
+		std::string csv;
+		for (int i = 0; i < 2000; ++i) {
+			csv.append("2021-01-").append(std::to_string(i % 28 + 10)).append(",123.45,").append(std::to_string(i * 7919 % 1000)).append("\r\n");
+		}
+		ensure(round_trip(csv) < csv.size() / 3);
+		std::string noise;
+		for (uint32_t i = 0, x = 1; i < 100000; ++i) {
+			x = x * 1103515245 + 12345;
+			noise.push_back(static_cast<char>(x >> 16));
+		}
+		round_trip(noise);
+
+		// corrupt blocks do not write past the end
+		auto c = compress(csv);
+		std::string d(csv.size(), 0);
+		ensure(decompress(c, d.data(), d.size() - 1) == std::string_view::npos);
+		ensure(decompress(c.substr(0, c.size() / 2), d.data(), d.size()) != csv.size());
+		ensure(decompress(std::string_view("\x0F\x00\x01", 3), d.data(), d.size()) == std::string_view::npos);
+
+		return 0;
+	}
+
+#endif // _DEBUG
+
+} // namespace fms::lz
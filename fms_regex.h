@@ -0,0 +1,819 @@
+// fms_regex.h - linear time regular expressions
+// Patterns compile to a program for a Pike VM that runs all threads in
+// lock step so matching is O(text * pattern) with no backtracking.
+// https://swtch.com/~rsc/regexp/regexp2.html
+#pragma once
+#include <bitset>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "fms_search.h"
+
+namespace fms::regex {
+
+	// Syntax: literals, ., [...], [^...], \d \w \s \D \W \S, \n \r \t \xHH,
+	// ^ and $ at line boundaries, (...), (?:...), |, and * + ? {m} {m,} {m,n}
+	// with lazy versions *? +? ?? {m,n}?. Text is UTF-8 and . and negated
+	// classes match one code point.
+	class program {
+	public:
+		enum class op : uint8_t { byte, set, split, jmp, save, bol, eol, match };
+		struct inst {
+			op o;
+			uint8_t c = 0; // byte
+			uint32_t x = 0, y = 0; // set index, jump targets, or save slot
+		};
+		static constexpr size_t max_size = 1 << 16;
+	private:
+		// abstract syntax
+		struct node {
+			enum class type { literal, set, any, cat, alt, rep, group, bol, eol } t;
+			std::string s; // literal bytes
+			std::bitset<128> ascii; // set members
+			bool nonascii = false; // set matches any non-ASCII code point
+			std::vector<std::unique_ptr<node>> kids;
+			unsigned min = 0, max = 0; // max 0 is unbounded
+			bool greedy = true;
+			int group = -1; // capture index
+		};
+		using pnode = std::unique_ptr<node>;
+
+		std::vector<inst> code_;
+		std::vector<std::bitset<256>> sets_;
+		unsigned groups_ = 0; // number of capturing groups
+		std::string prefix_; // literal every match starts with
+		std::bitset<256> first_; // bytes a match can start with
+
+		// parser
+		std::string_view p;
+
+		static pnode make(node::type t)
+		{
+			auto n = std::make_unique<node>();
+			n->t = t;
+
+			return n;
+		}
+		bool more() const
+		{
+			return !p.empty();
+		}
+		char peek() const
+		{
+			return p.front();
+		}
+		char next()
+		{
+			char c = p.front();
+			p.remove_prefix(1);
+
+			return c;
+		}
+		static int hex(char c)
+		{
+			if ('0' <= c and c <= '9') return c - '0';
+			if ('a' <= c and c <= 'f') return c - 'a' + 10;
+			if ('A' <= c and c <= 'F') return c - 'A' + 10;
+			return -1;
+		}
+		// add \d \w \s or their complements to a set, return false if not a class escape
+		static bool escape_class(char c, node& n)
+		{
+			std::bitset<128> b;
+			switch (c | 0x20) {
+			case 'd':
+				for (char i = '0'; i <= '9'; ++i) b.set(i);
+				break;
+			case 'w':
+				for (char i = '0'; i <= '9'; ++i) b.set(i);
+				for (char i = 'a'; i <= 'z'; ++i) b.set(i);
+				for (char i = 'A'; i <= 'Z'; ++i) b.set(i);
+				b.set('_');
+				break;
+			case 's':
+				for (char i : { ' ', '\t', '\n', '\r', '\f', '\v' }) b.set(i);
+				break;
+			default:
+				return false;
+			}
+			if (c & 0x20) {
+				n.ascii |= b;
+			}
+			else {
+				n.ascii |= ~b;
+				n.nonascii = true;
+			}
+
+			return true;
+		}
+		// single byte after '\\' that is not a class escape
+		char escape_byte()
+		{
+			ensure(more() || !__FUNCTION__ ": trailing backslash");
+			char c = next();
+			switch (c) {
+			case 'n': return '\n';
+			case 'r': return '\r';
+			case 't': return '\t';
+			case 'f': return '\f';
+			case 'v': return '\v';
+			case '0': return '\0';
+			case 'x': {
+				ensure((p.size() >= 2 and hex(p[0]) >= 0 and hex(p[1]) >= 0) || !__FUNCTION__ ": \\x needs two hex digits");
+				char x = static_cast<char>(16 * hex(p[0]) + hex(p[1]));
+				p.remove_prefix(2);
+				return x;
+			}
+			}
+			ensure(!(('a' <= c and c <= 'z') or ('A' <= c and c <= 'Z') or ('0' <= c and c <= '9')) || !__FUNCTION__ ": unsupported escape");
+
+			return c;
+		}
+		pnode parse_set()
+		{
+			auto n = make(node::type::set);
+			bool negate = more() and peek() == '^';
+			if (negate) {
+				next();
+			}
+			bool first = true;
+			while (more() and (first or peek() != ']')) {
+				first = false;
+				char c = next();
+				if (c == '\\') {
+					ensure(more() || !__FUNCTION__ ": trailing backslash");
+					if (escape_class(peek(), *n)) {
+						next();
+						continue;
+					}
+					c = escape_byte();
+				}
+				char d = c;
+				if (p.size() >= 2 and peek() == '-' and p[1] != ']') {
+					next();
+					d = next();
+					if (d == '\\') {
+						d = escape_byte();
+					}
+				}
+				ensure((0 <= c and c <= d) || !__FUNCTION__ ": character class members must be ASCII and ranges increasing");
+				for (int i = c; i <= d; ++i) {
+					n->ascii.set(i);
+				}
+			}
+			ensure((more() and next() == ']') || !__FUNCTION__ ": missing ]");
+			if (negate) {
+				n->ascii = ~n->ascii;
+				n->nonascii = !n->nonascii;
+			}
+
+			return n;
+		}
+		unsigned parse_int()
+		{
+			ensure((more() and '0' <= peek() and peek() <= '9') || !__FUNCTION__ ": expected number");
+			unsigned i = 0;
+			while (more() and '0' <= peek() and peek() <= '9') {
+				i = 10 * i + (next() - '0');
+				ensure(i <= 1000 || !__FUNCTION__ ": repeat count too large");
+			}
+
+			return i;
+		}
+		pnode parse_atom()
+		{
+			char c = next();
+			switch (c) {
+			case '(': {
+				int g = -1;
+				if (p.starts_with("?:")) {
+					p.remove_prefix(2);
+				}
+				else {
+					g = ++groups_;
+				}
+				auto n = make(node::type::group);
+				n->group = g;
+				n->kids.push_back(parse_alt());
+				ensure((more() and next() == ')') || !__FUNCTION__ ": missing )");
+				return n;
+			}
+			case '[':
+				return parse_set();
+			case '.': {
+				auto n = make(node::type::set);
+				n->ascii.set();
+				n->ascii.reset('\n');
+				n->nonascii = true;
+				return n;
+			}
+			case '^':
+				return make(node::type::bol);
+			case '$':
+				return make(node::type::eol);
+			case '\\': {
+				ensure(more() || !__FUNCTION__ ": trailing backslash");
+				auto n = make(node::type::set);
+				if (escape_class(peek(), *n)) {
+					next();
+					return n;
+				}
+				n = make(node::type::literal);
+				n->s.push_back(escape_byte());
+				return n;
+			}
+			case '*': case '+': case '?': case '{': case ')': case '|':
+				ensure(!__FUNCTION__ ": unexpected operator");
+			}
+			// whole UTF-8 sequence so a quantifier applies to the code point
+			auto n = make(node::type::literal);
+			n->s.push_back(c);
+			while ((static_cast<unsigned char>(c) & 0xC0) == 0xC0 and more() and (static_cast<unsigned char>(peek()) & 0xC0) == 0x80) {
+				n->s.push_back(next());
+			}
+
+			return n;
+		}
+		pnode parse_rep()
+		{
+			auto n = parse_atom();
+			while (more() and (peek() == '*' or peek() == '+' or peek() == '?' or peek() == '{')) {
+				auto r = make(node::type::rep);
+				char c = next();
+				if (c == '*') {
+					r->min = 0;
+					r->max = 0;
+				}
+				else if (c == '+') {
+					r->min = 1;
+					r->max = 0;
+				}
+				else if (c == '?') {
+					r->min = 0;
+					r->max = 1;
+				}
+				else {
+					r->min = r->max = parse_int();
+					if (more() and peek() == ',') {
+						next();
+						r->max = more() and peek() == '}' ? 0 : parse_int();
+						ensure((r->max == 0 or r->min <= r->max) || !__FUNCTION__ ": {m,n} needs m <= n");
+					}
+					ensure((more() and next() == '}') || !__FUNCTION__ ": missing }");
+					ensure((r->max != 0 or r->min != 0 or c != '{') || !__FUNCTION__ ": {0} is not supported");
+				}
+				if (more() and peek() == '?') {
+					next();
+					r->greedy = false;
+				}
+				r->kids.push_back(std::move(n));
+				n = std::move(r);
+			}
+
+			return n;
+		}
+		pnode parse_cat()
+		{
+			auto n = make(node::type::cat);
+			while (more() and peek() != '|' and peek() != ')') {
+				n->kids.push_back(parse_rep());
+			}
+
+			return n;
+		}
+		pnode parse_alt()
+		{
+			auto n = make(node::type::alt);
+			n->kids.push_back(parse_cat());
+			while (more() and peek() == '|') {
+				next();
+				n->kids.push_back(parse_cat());
+			}
+
+			return n;
+		}
+
+		// code generation
+		size_t emit(op o, uint32_t x = 0, uint32_t y = 0, uint8_t c = 0)
+		{
+			ensure(code_.size() < max_size || !__FUNCTION__ ": pattern too large");
+			code_.push_back(inst{ o, c, x, y });
+
+			return code_.size() - 1;
+		}
+		uint32_t here() const
+		{
+			return static_cast<uint32_t>(code_.size());
+		}
+		void emit_set(const std::bitset<256>& b)
+		{
+			sets_.push_back(b);
+			emit(op::set, static_cast<uint32_t>(sets_.size() - 1));
+		}
+		static std::bitset<256> range(unsigned lo, unsigned hi)
+		{
+			std::bitset<256> b;
+			for (unsigned i = lo; i <= hi; ++i) {
+				b.set(i);
+			}
+
+			return b;
+		}
+		// any multibyte UTF-8 sequence
+		void emit_nonascii()
+		{
+			auto s2 = emit(op::split);
+			code_[s2].x = here();
+			emit_set(range(0xC2, 0xDF));
+			emit_set(range(0x80, 0xBF));
+			auto j2 = emit(op::jmp);
+			code_[s2].y = here();
+			auto s3 = emit(op::split);
+			code_[s3].x = here();
+			emit_set(range(0xE0, 0xEF));
+			emit_set(range(0x80, 0xBF));
+			emit_set(range(0x80, 0xBF));
+			auto j3 = emit(op::jmp);
+			code_[s3].y = here();
+			emit_set(range(0xF0, 0xF4));
+			emit_set(range(0x80, 0xBF));
+			emit_set(range(0x80, 0xBF));
+			emit_set(range(0x80, 0xBF));
+			code_[j2].x = code_[j3].x = here();
+		}
+		void gen(const node& n)
+		{
+			switch (n.t) {
+			case node::type::literal:
+				for (auto c : n.s) {
+					emit(op::byte, 0, 0, static_cast<uint8_t>(c));
+				}
+				break;
+			case node::type::set: {
+				std::bitset<256> b;
+				for (unsigned i = 0; i < 128; ++i) {
+					b[i] = n.ascii[i];
+				}
+				if (!n.nonascii) {
+					emit_set(b);
+				}
+				else {
+					auto s = emit(op::split);
+					code_[s].x = here();
+					emit_set(b);
+					auto j = emit(op::jmp);
+					code_[s].y = here();
+					emit_nonascii();
+					code_[j].x = here();
+				}
+				break;
+			}
+			case node::type::cat:
+				for (const auto& k : n.kids) {
+					gen(*k);
+				}
+				break;
+			case node::type::alt: {
+				std::vector<size_t> jmps;
+				for (size_t i = 0; i + 1 < n.kids.size(); ++i) {
+					auto s = emit(op::split);
+					code_[s].x = here();
+					gen(*n.kids[i]);
+					jmps.push_back(emit(op::jmp));
+					code_[s].y = here();
+				}
+				gen(*n.kids.back());
+				for (auto j : jmps) {
+					code_[j].x = here();
+				}
+				break;
+			}
+			case node::type::rep:
+				for (unsigned i = 0; i < n.min; ++i) {
+					gen(*n.kids[0]);
+				}
+				if (n.max == 0) {
+					// L: split body, end; body; jmp L
+					auto l = emit(op::split);
+					gen(*n.kids[0]);
+					emit(op::jmp, static_cast<uint32_t>(l));
+					branch(l, l + 1, here(), n.greedy);
+				}
+				else {
+					std::vector<size_t> splits;
+					for (unsigned i = n.min; i < n.max; ++i) {
+						splits.push_back(emit(op::split));
+						gen(*n.kids[0]);
+					}
+					for (auto s : splits) {
+						branch(s, static_cast<uint32_t>(s + 1), here(), n.greedy);
+					}
+				}
+				break;
+			case node::type::group:
+				if (n.group >= 0) {
+					emit(op::save, 2 * n.group);
+				}
+				gen(*n.kids[0]);
+				if (n.group >= 0) {
+					emit(op::save, 2 * n.group + 1);
+				}
+				break;
+			case node::type::bol:
+				emit(op::bol);
+				break;
+			case node::type::eol:
+				emit(op::eol);
+				break;
+			case node::type::any:
+				break;
+			}
+		}
+		// first bytes reachable from pc without consuming input
+		void starts(size_t pc)
+		{
+			std::vector<bool> seen(code_.size());
+			std::vector<size_t> todo{ pc };
+			while (!todo.empty()) {
+				pc = todo.back();
+				todo.pop_back();
+				if (seen[pc]) {
+					continue;
+				}
+				seen[pc] = true;
+
+				const auto& in = code_[pc];
+				switch (in.o) {
+				case op::byte:
+					first_.set(in.c);
+					break;
+				case op::set:
+					first_ |= sets_[in.x];
+					break;
+				case op::split:
+					todo.push_back(in.y);
+					todo.push_back(in.x);
+					break;
+				case op::jmp:
+					todo.push_back(in.x);
+					break;
+				case op::match:
+					first_.set(); // empty match
+					break;
+				default:
+					todo.push_back(pc + 1);
+				}
+			}
+		}
+		// prefer body over skip if greedy
+		void branch(size_t s, size_t body, size_t skip, bool greedy)
+		{
+			code_[s].x = static_cast<uint32_t>(greedy ? body : skip);
+			code_[s].y = static_cast<uint32_t>(greedy ? skip : body);
+		}
+	public:
+		program(std::string_view pattern)
+			: p(pattern)
+		{
+			auto n = parse_alt();
+			ensure(!more() || !__FUNCTION__ ": unmatched )");
+
+			emit(op::save, 0);
+			gen(*n);
+			emit(op::save, 1);
+			emit(op::match);
+
+			// bytes every match starts with
+			for (size_t pc = 1; pc < code_.size() and code_[pc].o == op::byte; ++pc) {
+				prefix_.push_back(static_cast<char>(code_[pc].c));
+			}
+			starts(0);
+		}
+
+		const std::vector<inst>& code() const
+		{
+			return code_;
+		}
+		bool in(uint32_t set, unsigned char c) const
+		{
+			return sets_[set][c];
+		}
+		// capturing groups not including the whole match
+		unsigned groups() const
+		{
+			return groups_;
+		}
+		const std::string& prefix() const
+		{
+			return prefix_;
+		}
+		bool first(unsigned char c) const
+		{
+			return first_[c];
+		}
+	};
+
+	// Run a program over text. Buffers are reused between searches.
+	class matcher {
+		const program& prog;
+		size_t ncap;
+		// threads in priority order with their capture slots
+		struct list {
+			std::vector<uint32_t> pc;
+			std::vector<size_t> cap;
+			std::vector<uint32_t> mark; // generation pc was added
+			uint32_t gen = 0;
+
+			void clear()
+			{
+				pc.clear();
+				cap.clear();
+				++gen;
+			}
+		};
+		list clist, nlist;
+		std::vector<size_t> scratch;
+
+		static bool bol(std::string_view s, size_t i)
+		{
+			return i == 0 or s[i - 1] == '\n';
+		}
+		static bool eol(std::string_view s, size_t i)
+		{
+			return i == s.size() or s[i] == '\n' or (s[i] == '\r' and i + 1 < s.size() and s[i + 1] == '\n');
+		}
+
+		// pending work of add: follow pc or restore a capture slot
+		struct job {
+			static constexpr uint32_t visit = UINT32_MAX;
+
+			uint32_t pc;
+			uint32_t slot; // visit or capture slot to restore
+			size_t old;
+		};
+		std::vector<job> stack;
+
+		// Follow empty transitions from pc adding threads that consume a byte or match.
+		// Uses an explicit stack since chains of empty transitions can be as long as the program.
+		void add(list& l, uint32_t pc, size_t* cap, std::string_view s, size_t i)
+		{
+			stack.clear();
+			stack.push_back(job{ pc, job::visit, 0 });
+			while (stack.size()) {
+				auto j = stack.back();
+				stack.pop_back();
+				if (j.slot != job::visit) {
+					cap[j.slot] = j.old;
+					continue;
+				}
+
+				for (pc = j.pc; l.mark[pc] != l.gen; ) {
+					l.mark[pc] = l.gen;
+
+					const auto& in = prog.code()[pc];
+					bool follow = true;
+					switch (in.o) {
+					case program::op::jmp:
+						pc = in.x;
+						break;
+					case program::op::split:
+						stack.push_back(job{ in.y, job::visit, 0 }); // after all threads from in.x
+						pc = in.x;
+						break;
+					case program::op::save:
+						stack.push_back(job{ 0, in.x, cap[in.x] });
+						cap[in.x] = i;
+						++pc;
+						break;
+					case program::op::bol:
+						follow = bol(s, i);
+						++pc;
+						break;
+					case program::op::eol:
+						follow = eol(s, i);
+						++pc;
+						break;
+					default:
+						l.pc.push_back(pc);
+						l.cap.insert(l.cap.end(), cap, cap + ncap);
+						follow = false;
+					}
+					if (!follow) {
+						break;
+					}
+				}
+			}
+		}
+	public:
+		matcher(const program& prog)
+			: prog(prog), ncap(2 * (prog.groups() + 1)), scratch(ncap)
+		{
+			clist.mark.resize(prog.code().size(), 0);
+			nlist.mark.resize(prog.code().size(), 0);
+		}
+
+		// First match at or after start. Offsets of group k are cap[2k] and cap[2k + 1]
+		// or npos if the group did not participate.
+		bool search(std::string_view s, size_t start, std::vector<size_t>& cap)
+		{
+			const auto& prefix = prog.prefix();
+			bool matched = false;
+			cap.assign(ncap, s.npos);
+
+			clist.clear();
+			for (size_t i = start; i <= s.size(); ++i) {
+				if (!matched and clist.pc.empty()) {
+					// skip to the next possible match
+					if (prefix.size()) {
+						i = search::find(s, prefix, i);
+						if (i == s.npos) {
+							break;
+						}
+					}
+					else {
+						while (i < s.size() and !prog.first(static_cast<unsigned char>(s[i]))) {
+							++i;
+						}
+					}
+				}
+				if (!matched) {
+					std::fill(scratch.begin(), scratch.end(), s.npos);
+					add(clist, 0, scratch.data(), s, i);
+				}
+				if (clist.pc.empty()) {
+					if (matched) {
+						break;
+					}
+					clist.clear();
+					continue;
+				}
+
+				nlist.clear();
+				for (size_t t = 0; t < clist.pc.size(); ++t) {
+					const auto& in = prog.code()[clist.pc[t]];
+					size_t* tcap = clist.cap.data() + t * ncap;
+					if (in.o == program::op::match) {
+						matched = true;
+						std::copy(tcap, tcap + ncap, cap.begin());
+						break; // cut lower priority threads
+					}
+					if (i < s.size()) {
+						auto c = static_cast<unsigned char>(s[i]);
+						if ((in.o == program::op::byte and in.c == c) or (in.o == program::op::set and prog.in(in.x, c))) {
+							add(nlist, clist.pc[t] + 1, tcap, s, i + 1);
+						}
+					}
+				}
+				std::swap(clist, nlist);
+				if (i == s.size()) {
+					// threads left can only match at the end
+					for (size_t t = 0; t < clist.pc.size(); ++t) {
+						if (prog.code()[clist.pc[t]].o == program::op::match) {
+							matched = true;
+							std::copy(clist.cap.data() + t * ncap, clist.cap.data() + (t + 1) * ncap, cap.begin());
+							break;
+						}
+					}
+				}
+			}
+
+			return matched;
+		}
+	};
+
+	// Compiled programs by pattern so recalculation does not recompile.
+	class cache {
+		std::mutex mutex;
+		std::map<std::string, std::shared_ptr<const program>, std::less<>> programs;
+		std::deque<std::string> order; // oldest first
+	public:
+		static constexpr size_t max_size = 64;
+
+		std::shared_ptr<const program> get(std::string_view pattern)
+		{
+			std::lock_guard lock(mutex);
+
+			if (auto i = programs.find(pattern); i != programs.end()) {
+				return i->second;
+			}
+			auto prog = std::make_shared<const program>(pattern);
+			if (programs.size() == max_size) {
+				programs.erase(order.front());
+				order.pop_front();
+			}
+			programs.emplace(pattern, prog);
+			order.emplace_back(pattern);
+
+			return prog;
+		}
+		size_t size()
+		{
+			std::lock_guard lock(mutex);
+
+			return programs.size();
+		}
+	};
+
+#ifdef _DEBUG
+
+	inline int test()
+	{
+		auto match = [](std::string_view pattern, std::string_view s, size_t group = 0) {
+			program prog(pattern);
+			matcher m(prog);
+			std::vector<size_t> cap;
+			if (!m.search(s, 0, cap) or cap[2 * group] == s.npos) {
+				return std::string("<none>");
+			}
+			return std::string(s.substr(cap[2 * group], cap[2 * group + 1] - cap[2 * group]));
+		};
+
+		ensure(match("abc", "xxabcxx") == "abc");
+		ensure(match("abc", "xxabxx") == "<none>");
+		ensure(match("a.c", "abc") == "abc");
+		ensure(match("a.c", "a\nc") == "<none>");
+		ensure(match("a+", "baaab") == "aaa");
+		ensure(match("a+?", "baaab") == "a");
+		ensure(match("a*", "baaab") == "");
+		ensure(match("ba*", "baaab") == "baaa");
+		ensure(match("ba*?b", "baaab") == "baaab");
+		ensure(match("colou?r", "the color") == "color");
+		ensure(match("a{2,3}", "aaaa") == "aaa");
+		ensure(match("a{2,}", "aaaaa") == "aaaaa");
+		ensure(match("a{2}", "aaaa") == "aa");
+		ensure(match("a{2,3}?", "aaaa") == "aa");
+		ensure(match("cat|dog", "hotdog") == "dog");
+		ensure(match("(a|ab)(c|bcd)", "abcd") == "abcd");
+		ensure(match("(a|ab)(c|bcd)", "abcd", 2) == "bcd");
+		ensure(match("[0-9]+", "abc 1234 x") == "1234");
+		ensure(match("\\d+\\.\\d*", "pi is 3.14159!") == "3.14159");
+		ensure(match("[^,]+", ",,abc,def") == "abc");
+		ensure(match("\\w+@\\w+\\.com", "mail bob@example.com now") == "bob@example.com");
+		ensure(match("\\s+", "a \t b") == " \t ");
+		ensure(match("[a\\-z]+", "b-az") == "-az");
+		ensure(match("[]a]+", "x]a]") == "]a]");
+		ensure(match("^b", "ab\nbc") == "b");
+		ensure(match("b$", "ab\r\nbc") == "b");
+		ensure(match("^$", "a\n\nb") == "");
+		ensure(match("x$", "x") == "x");
+		ensure(match("(?:ab)+", "ababab") == "ababab");
+		ensure(match("(ab)+", "ababab", 1) == "ab");
+		ensure(match("(x)?y", "y", 1) == "<none>");
+		ensure(match("<td>(.*?)</td>", "<tr><td>1</td><td>2</td>", 1) == "1");
+		ensure(match("<td>(.*)</td>", "<tr><td>1</td><td>2</td>", 1) == "1</td><td>2");
+		ensure(match("caf.", "caf\xC3\xA9") == "caf\xC3\xA9");
+		ensure(match("[^a]", "a\xE2\x82\xAC") == "\xE2\x82\xAC");
+		ensure(match("\xC3\xA9+", "\xC3\xA9\xC3\xA9!") == "\xC3\xA9\xC3\xA9");
+		ensure(match("\\x41", "zA") == "A");
+
+		for (auto bad : { "(", ")", "a**b[", "[a", "\\", "a{3,2}", "\\q", "*a", "[\xC3\xA9]" }) {
+			bool thrown = false;
+			try {
+				program prog(bad);
+			}
+			catch (const std::exception&) {
+				thrown = true;
+			}
+			ensure(thrown);
+		}
+
+		{
+			// all matches
+			program prog("(\\w+)=(\\d+)");
+			matcher m(prog);
+			std::string_view s("a=1, bb=22,c=x, d=4");
+			std::vector<size_t> cap;
+			std::vector<std::string_view> keys;
+			for (size_t i = 0; m.search(s, i, cap); i = cap[1] > cap[0] ? cap[1] : cap[1] + 1) {
+				keys.push_back(s.substr(cap[2], cap[3] - cap[2]));
+			}
+			ensure(keys.size() == 3);
+			ensure(keys[0] == "a" and keys[1] == "bb" and keys[2] == "d");
+		}
+		{
+			// long chains of empty transitions do not recurse
+			std::string chain;
+			for (int i = 0; i < 15000; ++i) {
+				chain.append("(?:a?)");
+			}
+			ensure(match(chain + "b", "aaab") == "aaab");
+			ensure(match(chain + "(b)", "xb", 1) == "b");
+		}
+		{
+			cache c;
+			auto p = c.get("a+");
+			ensure(c.get("a+") == p);
+			ensure(c.size() == 1);
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+
+} // namespace fms::regex
@@ -0,0 +1,192 @@
+// fms_search.h - vectorized substring search
+// Compare the first and last byte of the needle against a block of the
+// haystack at once and only call memcmp where both match.
+// http://0x80.pl/articles/simd-strfind.html
+#pragma once
+#include <bit>
+#include <cstring>
+#include <string>
+#include <string_view>
+#if !defined(FMS_SEARCH_SCALAR) && defined(__AVX2__)
+#define FMS_SEARCH_SIMD 32
+#elif !defined(FMS_SEARCH_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define FMS_SEARCH_SIMD 16
+#endif
+#ifdef FMS_SEARCH_SIMD
+#include <immintrin.h>
+#endif
+
+namespace fms::search {
+
+#if FMS_SEARCH_SIMD == 32
+	constexpr size_t block = 32;
+
+	// bit i set if a[i] == x[i] and b[i] == y[i]
+	inline unsigned match(const char* a, const char* b, const __m256i& x, const __m256i& y)
+	{
+		auto ax = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a)), x);
+		auto by = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b)), y);
+
+		return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(ax, by)));
+	}
+	inline __m256i splat(char c)
+	{
+		return _mm256_set1_epi8(c);
+	}
+	using vector = __m256i;
+	inline vector load(const char* p)
+	{
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	}
+	// bit i set if a[i] == x[i]
+	inline unsigned eq(const vector& a, const vector& x)
+	{
+		return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, x)));
+	}
+#elif FMS_SEARCH_SIMD == 16
+	constexpr size_t block = 16;
+
+	inline unsigned match(const char* a, const char* b, const __m128i& x, const __m128i& y)
+	{
+		auto ax = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a)), x);
+		auto by = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b)), y);
+
+		return static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(ax, by)));
+	}
+	inline __m128i splat(char c)
+	{
+		return _mm_set1_epi8(c);
+	}
+	using vector = __m128i;
+	inline vector load(const char* p)
+	{
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	}
+	inline unsigned eq(const vector& a, const vector& x)
+	{
+		return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, x)));
+	}
+#endif
+
+	// offset of needle in s at or after start or npos if not found
+	inline size_t find(std::string_view s, std::string_view needle, size_t start = 0)
+	{
+		const size_t k = needle.size();
+		if (start > s.size() or k > s.size() - start) {
+			return s.npos;
+		}
+		if (k == 0) {
+			return start;
+		}
+		if (k == 1) {
+			auto p = static_cast<const char*>(memchr(s.data() + start, needle[0], s.size() - start));
+
+			return p ? p - s.data() : s.npos;
+		}
+
+		size_t i = start;
+#ifdef FMS_SEARCH_SIMD
+		const auto first = splat(needle.front());
+		const auto last = splat(needle.back());
+		// loads of s[i + k - 1, i + k - 1 + block) must stay in bounds
+		for (; i + k - 1 + block <= s.size(); i += block) {
+			auto m = match(s.data() + i, s.data() + i + k - 1, first, last);
+			while (m) {
+				auto j = i + std::countr_zero(m);
+				if (k == 2 or memcmp(s.data() + j + 1, needle.data() + 1, k - 2) == 0) {
+					return j;
+				}
+				m &= m - 1;
+			}
+		}
+#endif
+
+		return s.find(needle, i);
+	}
+
+	// number of non-overlapping occurrences of needle in s
+	inline size_t count(std::string_view s, std::string_view needle)
+	{
+		size_t n = 0;
+
+		if (needle.empty()) {
+			return n;
+		}
+		if (needle.size() == 1) {
+			size_t i = 0;
+#ifdef FMS_SEARCH_SIMD
+			const auto c = splat(needle[0]);
+			for (; i + block <= s.size(); i += block) {
+				n += std::popcount(match(s.data() + i, s.data() + i, c, c));
+			}
+#endif
+			for (; i < s.size(); ++i) {
+				n += s[i] == needle[0];
+			}
+
+			return n;
+		}
+
+		for (auto i = find(s, needle); i != s.npos; i = find(s, needle, i + needle.size())) {
+			++n;
+		}
+
+		return n;
+	}
+
+	// call f(i) for each offset i of c in s in increasing order
+	template<class F>
+	inline void each(std::string_view s, char c, F&& f)
+	{
+		size_t i = 0;
+#ifdef FMS_SEARCH_SIMD
+		const auto x = splat(c);
+		for (; i + block <= s.size(); i += block) {
+			for (auto m = match(s.data() + i, s.data() + i, x, x); m; m &= m - 1) {
+				f(i + std::countr_zero(m));
+			}
+		}
+#endif
+		for (; i < s.size(); ++i) {
+			if (s[i] == c) {
+				f(i);
+			}
+		}
+	}
+
+#ifdef _DEBUG
+
+	inline int test()
+	{
+		{
+			std::string_view s("abracadabra, the quick brown fox jumps over the lazy dog abracadabra");
+			for (auto n : { "a", "ab", "abra", "dog", "dog ", "abracadabra", "zz", "", "x", "abracadabrax" }) {
+				for (size_t i = 0; i <= s.size() + 1; ++i) {
+					ensure(find(s, n, i) == s.find(n, i));
+				}
+			}
+			ensure(count(s, "a") == 11);
+			ensure(count(s, "abra") == 4);
+			ensure(count(s, "the") == 2);
+			ensure(count(s, "aa") == 0);
+			ensure(count(s, "") == 0);
+			size_t n = 0, j = 0;
+			each(s, 'a', [&](size_t i) { ensure(i == s.find('a', j)); j = i + 1; ++n; });
+			ensure(n == 11);
+		}
+		{
+			std::string s(1000, 'a');
+			ensure(count(s, "aa") == 500);
+			ensure(count(s, "a") == 1000);
+			s[997] = 'b';
+			ensure(find(s, "ab") == 996);
+			ensure(find(s, "ba") == 997);
+			ensure(find(s, "aab", 996) == s.npos);
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+
+} // namespace fms::search
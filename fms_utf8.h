@@ -0,0 +1,182 @@
+// fms_utf8.h - validating UTF-8 to UTF-16 transcoding
+#pragma once
+#include <cstdint>
+#include <string_view>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FMS_UTF8_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace fms::utf8 {
+
+	constexpr char16_t replacement = 0xFFFD;
+
+	// Decode one code point at s[i] and advance i. Invalid sequences return
+	// replacement and advance past their longest valid prefix (WHATWG).
+	inline char32_t decode(std::string_view s, size_t& i)
+	{
+		auto b = static_cast<unsigned char>(s[i++]);
+		if (b < 0x80) {
+			return b;
+		}
+
+		unsigned n; // continuation bytes
+		char32_t c;
+		unsigned char lo = 0x80, hi = 0xBF; // range of second byte
+		if (0xC2 <= b and b <= 0xDF) {
+			n = 1;
+			c = b & 0x1F;
+		}
+		else if (0xE0 <= b and b <= 0xEF) {
+			n = 2;
+			c = b & 0x0F;
+			if (b == 0xE0) lo = 0xA0;
+			if (b == 0xED) hi = 0x9F; // surrogates
+		}
+		else if (0xF0 <= b and b <= 0xF4) {
+			n = 3;
+			c = b & 0x07;
+			if (b == 0xF0) lo = 0x90;
+			if (b == 0xF4) hi = 0x8F; // > U+10FFFF
+		}
+		else {
+			return replacement;
+		}
+
+		for (unsigned k = 0; k < n; ++k) {
+			if (i == s.size()) {
+				return replacement;
+			}
+			auto d = static_cast<unsigned char>(s[i]);
+			if (d < lo or d > hi) {
+				return replacement;
+			}
+			lo = 0x80;
+			hi = 0xBF;
+			c = (c << 6) | (d & 0x3F);
+			++i;
+		}
+
+		return c;
+	}
+
+	// Transcode s to UTF-16 in out having room for at least s.size() units.
+	// Return the number of units written.
+	template<class W>
+	inline size_t to_utf16(std::string_view s, W* out)
+	{
+		static_assert(sizeof(W) == 2);
+
+		size_t i = 0, j = 0;
+		while (i < s.size()) {
+#ifdef FMS_UTF8_SSE2
+			// ASCII fast path widens 16 bytes at a time
+			const __m128i zero = _mm_setzero_si128();
+			while (i + 16 <= s.size()) {
+				auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.data() + i));
+				if (_mm_movemask_epi8(x)) {
+					break;
+				}
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + j), _mm_unpacklo_epi8(x, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + j + 8), _mm_unpackhi_epi8(x, zero));
+				i += 16;
+				j += 16;
+			}
+			if (i == s.size()) {
+				break;
+			}
+#endif
+			auto c = decode(s, i);
+			if (c < 0x10000) {
+				out[j++] = static_cast<W>(c);
+			}
+			else {
+				c -= 0x10000;
+				out[j++] = static_cast<W>(0xD800 + (c >> 10));
+				out[j++] = static_cast<W>(0xDC00 + (c & 0x3FF));
+			}
+		}
+
+		return j;
+	}
+
+	// Bytes in the longest prefix of s having at most n UTF-16 units
+	// that does not split a UTF-8 sequence.
+	inline size_t prefix(std::string_view s, size_t n)
+	{
+		size_t i = 0;
+		while (i < s.size() and n > 0) {
+			if (static_cast<unsigned char>(s[i]) < 0x80) {
+				++i;
+				--n;
+			}
+			else {
+				auto j = i;
+				auto w = decode(s, j) < 0x10000 ? 1u : 2u;
+				if (w > n) {
+					break;
+				}
+				i = j;
+				n -= w;
+			}
+		}
+
+		return i;
+	}
+
+	// true if s is well formed UTF-8
+	inline bool valid(std::string_view s)
+	{
+		size_t i = 0;
+		while (i < s.size()) {
+			auto b = i;
+			if (decode(s, i) == replacement and s.substr(b, 3) != "\xEF\xBF\xBD") {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+#ifdef _DEBUG
+
+	inline int test()
+	{
+		char16_t buf[64];
+		auto utf16 = [&buf](std::string_view s) {
+			return std::u16string_view(buf, to_utf16(s, buf));
+		};
+
+		ensure(utf16("") == u"");
+		ensure(utf16("abc") == u"abc");
+		ensure(utf16("0123456789abcdef0123456789") == u"0123456789abcdef0123456789");
+		ensure(utf16("caf\xC3\xA9") == u"caf\u00E9");
+		ensure(utf16("0123456789abcde\xE2\x82\xAC!") == u"0123456789abcde\u20AC!");
+		ensure(utf16("\xF0\x9F\x98\x80") == u"\U0001F600");
+		ensure(utf16("\xEF\xBF\xBD") == u"\uFFFD");
+		// invalid
+		ensure(utf16("a\x80z") == u"a\uFFFDz");
+		ensure(utf16("\xC0\xAF") == u"\uFFFD\uFFFD"); // overlong
+		ensure(utf16("\xED\xA0\x80") == u"\uFFFD\uFFFD\uFFFD"); // surrogate
+		ensure(utf16("\xE2\x82") == u"\uFFFD"); // truncated
+		ensure(utf16("\xE2\x82z") == u"\uFFFDz");
+		ensure(utf16("\xF4\x90\x80\x80") == u"\uFFFD\uFFFD\uFFFD\uFFFD"); // > U+10FFFF
+
+		ensure(prefix("abc", 2) == 2);
+		ensure(prefix("abc", 5) == 3);
+		ensure(prefix("caf\xC3\xA9", 4) == 5);
+		ensure(prefix("caf\xC3\xA9", 3) == 3);
+		ensure(prefix("a\xF0\x9F\x98\x80", 2) == 1);
+		ensure(prefix("a\xF0\x9F\x98\x80", 3) == 5);
+		ensure(prefix("\x80\x80", 1) == 1);
+
+		ensure(valid("caf\xC3\xA9 \xF0\x9F\x98\x80 \xEF\xBF\xBD"));
+		ensure(!valid("\xC3"));
+		ensure(!valid("\xFF"));
+
+		return 0;
+	}
+
+#endif // _DEBUG
+
+} // namespace fms::utf8
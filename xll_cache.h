@@ -0,0 +1,271 @@
+// xll_cache.h - binary columnar caches of parsed data mapped into memory
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "fms_columns.h"
+#include "fms_csv.h"
+#include "fms_hash.h"
+#include "xll_table.h"
+#include "xll_utf8.h"
+
+namespace xll::cache {
+
+	static_assert(static_cast<int>(fms::columns::type::date) == static_cast<int>(table::type::date));
+	static_assert(static_cast<int>(fms::columns::type::string) == static_cast<int>(table::type::string));
+
+	// Read-only mapping of a whole file. The view is empty if the file can not be mapped.
+	class mapping {
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE map = NULL;
+		const char* p = nullptr;
+		size_t n = 0;
+	public:
+		mapping(const char* path)
+		{
+			file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			LARGE_INTEGER size;
+			if (file == INVALID_HANDLE_VALUE or !GetFileSizeEx(file, &size) or size.QuadPart == 0) {
+				return;
+			}
+			map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (map) {
+				p = static_cast<const char*>(MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0));
+				n = p ? static_cast<size_t>(size.QuadPart) : 0;
+			}
+		}
+		mapping(const mapping&) = delete;
+		mapping& operator=(const mapping&) = delete;
+		~mapping()
+		{
+			if (p) {
+				UnmapViewOfFile(p);
+			}
+			if (map) {
+				CloseHandle(map);
+			}
+			if (file != INVALID_HANDLE_VALUE) {
+				CloseHandle(file);
+			}
+		}
+
+		std::string_view view() const
+		{
+			return std::string_view(p, n);
+		}
+	};
+
+	// File holding the cache at path made from source, e.g., "spy.cache.0123456789abcdef".
+	// Each source has its own file so writing a cache never replaces a file
+	// that a cached table or a returned array still maps.
+	inline std::string name(const char* path, uint64_t source)
+	{
+		char hex[18];
+		snprintf(hex, sizeof(hex), ".%016llx", static_cast<unsigned long long>(source));
+
+		return std::string(path) + hex;
+	}
+
+	// Delete the cache files at path other than keep. Files that are still
+	// mapped can not be deleted and are left for a later call.
+	inline void remove(const char* path, const std::string& keep = std::string{})
+	{
+		std::string p(path);
+		auto dir = p.substr(0, p.find_last_of("\\/") + 1);
+		auto base = p.size() - dir.size();
+		WIN32_FIND_DATAA fd;
+		HANDLE h = FindFirstFileA((p + ".*").c_str(), &fd);
+		if (h == INVALID_HANDLE_VALUE) {
+			return;
+		}
+		do {
+			auto f = dir + fd.cFileName;
+			if (f.size() == p.size() + 17 and f.compare(0, p.size(), p) == 0 and f != keep
+				and strspn(fd.cFileName + base + 1, "0123456789abcdef") == 16) {
+				DeleteFileA(f.c_str());
+			}
+		} while (FindNextFileA(h, &fd));
+		FindClose(h);
+	}
+
+	// Write s to the cache file of path made from source and remove older ones.
+	// Bytes are written to a temporary file that is then renamed so a reader
+	// never maps part of a file.
+	inline bool write(const char* path, uint64_t source, std::string_view s)
+	{
+		std::string file = name(path, source);
+		std::string tmp = file + ".tmp";
+		HANDLE h = CreateFileA(tmp.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (h == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		bool ok = true;
+		for (size_t i = 0; ok and i < s.size(); ) {
+			DWORD m = static_cast<DWORD>(std::min<size_t>(s.size() - i, 1 << 30));
+			DWORD n = 0;
+			ok = WriteFile(h, s.data() + i, m, &n, NULL) and n == m;
+			i += m;
+		}
+		CloseHandle(h);
+		ok = ok and MoveFileExA(tmp.c_str(), file.c_str(), MOVEFILE_REPLACE_EXISTING);
+		if (!ok) {
+			DeleteFileA(tmp.c_str());
+		}
+		else {
+			remove(path, file);
+		}
+
+		return ok;
+	}
+
+	// Bytes describing how a source is parsed. The dialect and arguments
+	// such as predicates change the result so they are part of the key.
+	inline std::string how(std::string_view kind, const fms::csv::dialect& d, const OPER& o)
+	{
+		std::string s(kind);
+		s.append({ d.rs, d.fs, d.esc, d.quote });
+		for (const auto& x : o) {
+			s.push_back(static_cast<char>(x.xltype));
+			if (x.is_num()) {
+				double a = x.as_num();
+				s.append(reinterpret_cast<const char*>(&a), sizeof(a));
+			}
+			else if (x.is_str()) {
+				s.append(to_utf8(x)).push_back(0);
+			}
+			else if (x.xltype == xltypeBool) {
+				s.push_back(static_cast<char>(x.val.xbool));
+			}
+		}
+
+		return s;
+	}
+
+	// hash of the source bytes seeded with how they are parsed
+	inline uint64_t key(std::string_view s, std::string_view how)
+	{
+		return fms::hash::of(s, fms::hash::of(how));
+	}
+
+	// mapping of the cache at path if it was made from the same source and is intact
+	inline std::unique_ptr<mapping> open(const char* path, uint64_t source)
+	{
+		auto m = std::make_unique<mapping>(name(path, source).c_str());
+		fms::columns::reader r(m->view());
+
+		return r and r.source() == source ? std::move(m) : nullptr;
+	}
+
+	// cache file of a table
+	inline std::string file(const columnar& t, uint64_t source)
+	{
+		using fms::columns::type;
+
+		fms::columns::writer w(source, t.rows());
+		for (size_t j = 0; j < t.size(); ++j) {
+			const auto& col = t[j];
+			auto name = to_utf8(col.name); // empty if unnamed
+			switch (col.t) {
+			case columnar::type::integer:
+				w.integers(name, col.i64.data());
+				break;
+			case columnar::type::number:
+				w.doubles(name, type::number, col.num.data());
+				break;
+			case columnar::type::date:
+				w.doubles(name, type::date, col.num.data());
+				break;
+			case columnar::type::string:
+				w.strings(name, col.code.data(), col.dictionary);
+				break;
+			}
+		}
+
+		return w.str();
+	}
+
+	// cache file of a nonempty two dimensional array
+	inline std::string file(const _FPX& a, uint64_t source)
+	{
+		fms::columns::writer w(source, a.rows);
+		w.doubles("", fms::columns::type::array, a.array, a.columns);
+
+		return w.str();
+	}
+
+	// array in a cache without copying or null if it does not hold one
+	inline const _FPX* array(const mapping& m)
+	{
+		fms::columns::reader r(m.view());
+		if (!r or r.size() != 1 or r.kind(0) != fms::columns::type::array) {
+			return nullptr;
+		}
+
+		return static_cast<const _FPX*>(r.block(0));
+	}
+
+	// Table in a mapped cache file. Number and date columns are returned in place.
+	class cached : public table {
+		std::unique_ptr<mapping> m;
+		fms::columns::reader r;
+	public:
+		cached(std::unique_ptr<mapping> m_)
+			: m(std::move(m_)), r(m->view())
+		{
+			ensure(r || !__FUNCTION__ ": not a cache file");
+			for (size_t j = 0; j < r.size(); ++j) {
+				ensure(r.kind(j) != fms::columns::type::array || !__FUNCTION__ ": cache does not hold a table");
+			}
+		}
+
+		size_t rows() const override
+		{
+			return r.rows();
+		}
+		size_t size() const override
+		{
+			return r.size();
+		}
+		OPER heading(size_t j) const override
+		{
+			auto name = r.name(j);
+
+			return name.empty() ? OPER(static_cast<double>(j)) : utf8(name);
+		}
+		type kind(size_t j) const override
+		{
+			return static_cast<type>(r.kind(j));
+		}
+		OPER cell(size_t i, size_t j) const override
+		{
+			switch (kind(j)) {
+			case type::integer:
+				return OPER(static_cast<double>(r.integers(j)[i]));
+			case type::number:
+			case type::date:
+				return std::isnan(r.doubles(j)[i]) ? OPER(ErrNA) : OPER(r.doubles(j)[i]);
+			case type::string:
+				return utf8(r.word(j, r.codes(j)[i]));
+			}
+
+			return ErrNA;
+		}
+		double number(size_t i, size_t j) const override
+		{
+			return kind(j) == type::integer ? static_cast<double>(r.integers(j)[i]) : r.doubles(j)[i];
+		}
+		const _FPX* array(size_t j) const override
+		{
+			return kind(j) == type::number or kind(j) == type::date ? static_cast<const _FPX*>(r.block(j)) : nullptr;
+		}
+		size_t bytes() const override
+		{
+			return sizeof(*this) + m->view().size();
+		}
+	};
+
+} // namespace xll::cache
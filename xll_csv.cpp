@@ -2,7 +2,18 @@
 #ifdef _DEBUG
 #include <cassert>
 #endif
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <limits>
+#include <map>
+#include <memory>
+#include <thread>
+#include "fms_csv.h"
+#include "xll_cache.h"
 #include "xll_parse.h"
+#include "xll_utf8.h"
+#include "xll_view.h"
 
 using namespace xll;
 
@@ -94,48 +105,151 @@ AddIn xai_csv_parse(
 	.Arguments({
 		Arg(XLL_HANDLEX, "csv", "is a handle to a string of comma separated values."),
 		Arg(XLL_CSTRING4, "_rs", "is an optional record separator. Default is newline '\\n'."),
-		Arg(XLL_CSTRING4, "_fs", "is an optional field separator. Default is comma ','."),
+		Arg(XLL_CSTRING4, "_fs", "is an optional field separator or \"auto\" to sniff the dialect. Default is comma ','."),
 		Arg(XLL_CSTRING4, "_esc", "is an optional escape character. Default is backslash '\\'."),
+		Arg(XLL_LONG, "_offset", "is an optional number of records to skip. Default is 0."),
+		Arg(XLL_LONG, "_count", "is an optional number of records to return. Default is all."),
+		Arg(XLL_LPOPER, "_columns", "are optional 0-based column indices or names in the first record to return. Default is all."),
 		})
 	.FunctionHelp("Parse handle to a CSV string into a range.")
 	.Category("CSV")
 	.Documentation(R"xyzyx(
 Convert comma separated values to a range. 
+Fields are found in one pass using vectorized comparisons. Quotes around fields
+are removed, doubled quotes are replaced by one quote, and the escape character
+makes the next character literal. Lines may end in <code>"\r\n"</code>.
+<p>
+Large views are split into chunks at record separators that are tokenized on all cores.
+Each chunk assumes it does not start inside a quoted field. A serial pass over the
+chunk quote parities finds the wrong guesses and only those chunks are tokenized again.
+</p>
+<p>
+Records skipped by <code>offset</code> are only scanned for record separators and
+scanning stops after <code>count</code> records. Only the fields in <code>columns</code>
+are converted to strings. Column names are matched against the first record
+of the view and missing fields are <code>#N/A</code>.
+</p>
+<p>
+A rope returned by <code>\VIEW.CONCAT</code> is parsed one segment at a time
+and records that cross segments are joined without copying the whole rope.
+</p>
 )xyzyx")
 );
-LPOPER WINAPI xll_csv_parse(HANDLEX hcsv, const char* _rs, const char* _fs, const char* _e)
+LPOPER WINAPI xll_csv_parse(HANDLEX hcsv, const char* _rs, const char* _fs, const char* _e, LONG offset, LONG count, LPOPER pcolumns)
 {
 #pragma XLLEXPORT
 	static OPER o;
 
 	try {
-		handle<fms::view<char>> h_(hcsv);
-		ensure(h_);
+		ensure(offset >= 0 || !__FUNCTION__ ": offset must be non-negative");
+		ensure(count >= 0 || !__FUNCTION__ ": count must be non-negative");
 
-		char rs = *_rs ? *_rs : '\n';
-		char fs = *_fs ? *_fs : ',';
-		char e = *_e ? *_e : '\\';
-		auto v = fms::char_view<char>(h_->buf, h_->len);
+		auto d = csv_dialect(hcsv, _rs, _fs, _e);
+		std::string tmp;
+
+		// columns to return, empty for all
+		std::vector<unsigned> cols;
+		bool named = false;
+		if (!pcolumns->is_missing() and !pcolumns->is_nil()) {
+			for (const auto& col : *pcolumns) {
+				ensure(col.is_num() or col.is_str());
+				named = named or col.is_str();
+				cols.push_back(col.is_num() ? static_cast<unsigned>(col.as_num()) : UINT_MAX);
+			}
+		}
+		// match column names against the fields of the first record
+		auto resolve = [&](std::string_view record) {
+			named = false;
+			fms::csv::index ix(record, d);
+			if (ix.size() == 0) {
+				return;
+			}
+			for (unsigned k = 0; k < cols.size(); ++k) {
+				const auto& col = (*pcolumns)[k];
+				if (col.is_str()) {
+					for (unsigned j = 0; j < ix.fields(0); ++j) {
+						if (utf8(fms::csv::unquote(ix.field(record, 0, j), d, tmp)) == col) {
+							cols[k] = j;
+							break;
+						}
+					}
+				}
+			}
+		};
 
 		unsigned r = 0;
 		unsigned c = 0;
-		auto records = fms::parse::splitable(v, rs, '"', '"', e);
-		for (auto record : records) {
-			unsigned i = 0;
-			auto fields = fms::parse::splitable(record, fs, '"', '"', e);
-			for (auto field : fields) {
-				if (r == 0) {
-					c = static_cast<unsigned>(std::distance(fields.begin(), fields.end()));
-					o.resize(1, c);
-				}
-				else if (i == 0) {
-					o.resize(r + 1, c);
-				}
-				ensure(i < c);
-				o(r, i) = OPER(field.buf, field.len);
-				++i;
+		unsigned rows = 0; // allocated
+		// append the records of s
+		auto add = [&](std::string_view s, unsigned threads) {
+			fms::csv::index ix(s, d, threads);
+			if (ix.size() and r == 0) {
+				c = cols.empty() ? static_cast<unsigned>(ix.fields(0)) : static_cast<unsigned>(cols.size());
 			}
-			++r;
+			// allocate all records of s at once, doubling for ropes that add one record at a time
+			if (r + ix.size() > rows) {
+				rows = std::max(r + static_cast<unsigned>(ix.size()), 2 * rows);
+				o.resize(rows, c);
+			}
+			for (size_t k = 0; k < ix.size(); ++k) {
+				auto n = static_cast<unsigned>(ix.fields(k));
+				if (cols.empty()) {
+					ensure(n <= c);
+					for (unsigned i = 0; i < n; ++i) {
+						o(r, i) = utf8(fms::csv::unquote(ix.field(s, k, i), d, tmp));
+					}
+				}
+				else {
+					for (unsigned i = 0; i < c; ++i) {
+						auto j = cols[i];
+						o(r, i) = j < n ? utf8(fms::csv::unquote(ix.field(s, k, j), d, tmp)) : OPER(ErrNA);
+					}
+				}
+				++r;
+			}
+		};
+
+		if (auto rope_ = rope<char>(hcsv)) {
+			// records crossing segments are the only data copied
+			fms::csv::stream s(d);
+			size_t k = 0; // record number
+			auto f = [&](std::string_view record) {
+				if (k == 0 and named) {
+					resolve(record);
+				}
+				if (k++ >= static_cast<size_t>(offset)) {
+					// an empty record has one empty field as in the contiguous index
+					add(record.empty() ? std::string_view(&d.rs, 1) : record, 1);
+				}
+				return count == 0 or k < static_cast<size_t>(offset) + count;
+			};
+			bool first = true;
+			rope_->each([&](std::string_view segment) {
+				if (first and segment.starts_with("\xEF\xBB\xBF")) {
+					segment.remove_prefix(3); // as text() does for contiguous views
+				}
+				first = false;
+				return s.feed(segment, f);
+			});
+			s.finish(f);
+		}
+		else {
+			auto u = text(*resident<char>(hcsv));
+			std::string_view s(u.buf, u.len);
+			if (named) {
+				resolve(s.substr(0, fms::csv::skip(s, d, 1)));
+			}
+			s.remove_prefix(fms::csv::skip(s, d, offset));
+			if (count) {
+				s = s.substr(0, fms::csv::skip(s, d, count));
+			}
+			add(s, std::thread::hardware_concurrency());
+		}
+		if (r == 0) {
+			o = ErrNA;
+		}
+		else if (r < rows) {
+			o.resize(r, c);
 		}
 	}
 	catch (const std::exception& ex) {
@@ -147,59 +261,321 @@ LPOPER WINAPI xll_csv_parse(HANDLEX hcsv, const char* _rs, const char* _fs, cons
 	return &o;
 }
 
+AddIn xai_csv_sniff(
+	Function(XLL_LPOPER, "xll_csv_sniff", "CSV.SNIFF")
+	.Arguments({
+		Arg(XLL_HANDLEX, "view", "is a handle to a view of comma separated values."),
+		})
+	.FunctionHelp("Return the record separator, field separator, escape, quote, header, and line ending of view.")
+	.Category("CSV")
+	.Documentation(R"xyzyx(
+The dialect is inferred from the whole records in the first 16KB of the view.
+Character counts found with vector compares pick the record separator and the
+candidate field separators and quotes. The candidate that splits the most records
+into the same number of at least two fields wins. The first record is a header
+if its fields are not numeric in columns that are mostly numeric below it.
+Backslash is the escape character only if it is followed by a special character.
+<p>
+The result is cached on the view. Use <code>"auto"</code> as the field separator of
+<code>CSV.PARSE</code>, <code>CSV.PARSE.TIMESERIES</code>, and <code>\CSV.TABLE</code> to use it.
+</p>
+)xyzyx")
+);
+LPOPER WINAPI xll_csv_sniff(HANDLEX view)
+{
+#pragma XLLEXPORT
+	static OPER o;
+
+	try {
+		auto s = sniff(view);
+		auto chr = [](char c) { return utf8(std::string_view(&c, c ? 1 : 0)); };
+
+		o = OPER(6, 2);
+		o(0, 0) = "rs";
+		o(0, 1) = chr(s.d.rs);
+		o(1, 0) = "fs";
+		o(1, 1) = chr(s.d.fs);
+		o(2, 0) = "esc";
+		o(2, 1) = chr(s.d.esc);
+		o(3, 0) = "quote";
+		o(3, 1) = chr(s.d.quote);
+		o(4, 0) = "header";
+		o(4, 1) = OPER(s.header);
+		o(5, 0) = "crlf";
+		o(5, 1) = OPER(s.crlf);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		o = ErrNA;
+	}
+
+	return &o;
+}
+
+// Predicates on the raw bytes of fields evaluated before any field is converted.
+// Each row of the range is a column index or name, an operator, and values.
+class where {
+	enum class op { eq, ne, lt, le, gt, ge, in, between };
+	struct predicate {
+		OPER column; // index or name
+		unsigned j = UINT_MAX; // resolved column index
+		op o;
+		std::vector<OPER> values; // of comparisons, converted once j is known
+		std::vector<double> numbers;
+		std::vector<std::string> strings; // UTF-8
+	};
+	std::vector<predicate> ps;
+
+	// field as a number or date, dates first in the first column like the conversion
+	static bool value(std::string_view f, double& x, bool date)
+	{
+		return date ? fms::date::parse(f, x) or parse::number(f, x) : parse::number(f, x) or fms::date::parse(f, x);
+	}
+
+	// convert comparison values the way fields of column p.j are converted
+	static void convert(predicate& p)
+	{
+		for (const auto& v : p.values) {
+			double x;
+			if (v.is_num()) {
+				x = v.as_num();
+			}
+			else {
+				ensure(value(parse::trim(to_utf8(v)), x, p.j == 0) || !__FUNCTION__ ": comparison value must be a number or date");
+			}
+			p.numbers.push_back(x);
+		}
+	}
+
+	static bool test(const predicate& p, std::string_view f)
+	{
+		if (p.o == op::eq or p.o == op::ne or p.o == op::in) {
+			bool found = std::find(p.strings.begin(), p.strings.end(), f) != p.strings.end();
+			double x;
+			if (!found and p.numbers.size() and value(f, x, p.j == 0)) {
+				found = std::find(p.numbers.begin(), p.numbers.end(), x) != p.numbers.end();
+			}
+
+			return p.o == op::ne ? !found : found;
+		}
+
+		double x;
+		if (!value(f, x, p.j == 0)) {
+			return false;
+		}
+		auto a = p.numbers[0];
+		switch (p.o) {
+		case op::lt: return x < a;
+		case op::le: return x <= a;
+		case op::gt: return x > a;
+		case op::ge: return x >= a;
+		case op::between: return a <= x and x <= p.numbers[1];
+		default: return false;
+		}
+	}
+public:
+	where(const OPER& w)
+	{
+		if (w.is_missing() or w.is_nil()) {
+			return;
+		}
+		ensure(w.columns() >= 3 || !__FUNCTION__ ": predicates must have a column, operator, and value");
+		for (unsigned i = 0; i < w.rows(); ++i) {
+			predicate p;
+			p.column = w(i, 0);
+			ensure(p.column.is_num() or p.column.is_str());
+			if (p.column.is_num()) {
+				p.j = static_cast<unsigned>(p.column.as_num());
+			}
+
+			static const std::map<std::string_view, op> ops = {
+				{ "=", op::eq }, { "<>", op::ne }, { "<", op::lt }, { "<=", op::le }, { ">", op::gt }, { ">=", op::ge },
+				{ "in", op::in }, { "between", op::between },
+			};
+			auto name = to_utf8(w(i, 1));
+			std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+			auto o = ops.find(name);
+			ensure(o != ops.end() || !__FUNCTION__ ": operator must be =, <>, <, <=, >, >=, in, or between");
+			p.o = o->second;
+
+			bool compare = p.o != op::eq and p.o != op::ne and p.o != op::in;
+			for (unsigned k = 2; k < w.columns(); ++k) {
+				const auto& v = w(i, k);
+				if (compare and (v.is_num() or v.is_str())) {
+					p.values.push_back(v);
+				}
+				else if (v.is_num()) {
+					p.numbers.push_back(v.as_num());
+				}
+				else if (v.is_str()) {
+					p.strings.push_back(to_utf8(v));
+				}
+			}
+			if (p.o == op::between) {
+				ensure(p.values.size() >= 2 || !__FUNCTION__ ": between needs two values");
+			}
+			else if (compare) {
+				ensure(p.values.size() >= 1 || !__FUNCTION__ ": comparison needs a value");
+			}
+			// named columns are converted by resolve
+			if (p.j != UINT_MAX) {
+				convert(p);
+			}
+
+			ps.push_back(p);
+		}
+	}
+
+	bool empty() const
+	{
+		return ps.empty();
+	}
+
+	// resolve column names given name(j) for j < n
+	template<class F>
+	void resolve(size_t n, F&& name)
+	{
+		for (auto& p : ps) {
+			if (p.column.is_str()) {
+				auto s = to_utf8(p.column);
+				for (unsigned j = 0; j < n and p.j == UINT_MAX; ++j) {
+					if (name(j) == s) {
+						p.j = j;
+						convert(p);
+					}
+				}
+			}
+		}
+	}
+
+	// true if all predicates hold where field(j) is field j trimmed and unquoted
+	template<class F>
+	bool operator()(F&& field) const
+	{
+		for (const auto& p : ps) {
+			if (p.j == UINT_MAX or !test(p, field(p.j))) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+};
+
 AddIn xai_csv_parse_timeseries(
 	Function(XLL_FPX, "xll_csv_parse_timeseries", "CSV.PARSE.TIMESERIES")
 	.Arguments({
 		Arg(XLL_HANDLEX, "view", "is handle to a view."),
 		Arg(XLL_CSTRING4, "_rs", "is an optional record separator. Default is newline '\\n'."),
-		Arg(XLL_CSTRING4, "_fs", "is an optional field separator. Default is comma ','."),
+		Arg(XLL_CSTRING4, "_fs", "is an optional field separator or \"auto\" to sniff the dialect. Default is comma ','."),
 		Arg(XLL_CSTRING4, "_esc", "is an optional escape character. Default is backslash '\\'."),
+		Arg(XLL_LPOPER, "_where", "is an optional range of rows having a column, operator, and values to keep rows for."),
+		Arg(XLL_CSTRING4, "_cache", "is an optional path of a binary cache file for the result."),
 		})
 	.FunctionHelp("Parse view into a timeseries.")
 	.Category("CSV")
 	.Documentation(R"xyzyx(
 Convert comma separated values to a range. First column must be a date.
+Dates having the form <code>yyyy-mm-dd</code>, <code>yyyy-mm-dd hh:mm:ss</code>, <code>yyyymmdd</code>,
+or Unix epoch seconds or milliseconds are converted to Excel dates without calling Excel.
+Rows not starting with a digit are skipped. Rows are counted before the result is allocated once.
+<p>
+Each row of <code>where</code> is a 0-based column index or a name in the first record,
+an operator, and values. Operators are <code>=</code>, <code>&lt;&gt;</code>, <code>&lt;</code>,
+<code>&lt;=</code>, <code>&gt;</code>, <code>&gt;=</code>, <code>in</code>, and <code>between</code>.
+Values are numbers, dates, or strings. For example <code>{0, "between", "2021-01-01", "2021-06-30"; "sym", "in", "IBM", "MSFT"}</code>
+keeps the first half of 2021 for two symbols. Predicates are evaluated on the bytes of the fields
+before anything is converted so rejected rows only cost finding their fields.
+</p>
+<p>
+If <code>_cache</code> is a file made from the same bytes of <code>view</code> with the same
+dialect and predicates the result is returned from the mapped file without parsing or copying.
+Otherwise the result is saved to a new file. Files are named by appending a hash of the source
+to <code>_cache</code> so a cache made from data that has since changed is never used and
+a file that is still mapped is never replaced.
+</p>
 )xyzyx")
 );
-_FPX* WINAPI xll_csv_parse_timeseries(HANDLEX csv, const char* _rs, const char* _fs, const char* _e)
+_FPX* WINAPI xll_csv_parse_timeseries(HANDLEX csv, const char* _rs, const char* _fs, const char* _e, LPOPER pwhere, const char* _cache)
 {
 #pragma XLLEXPORT
 	static FPX o;
+	static std::unique_ptr<cache::mapping> mapped; // holding the last result returned from a cache
 
 	try {
-		handle<fms::view<char>> h_(csv);
-		ensure(h_);
+		mapped.reset(); // Excel has copied the last result
+		auto d = csv_dialect(csv, _rs, _fs, _e);
+		auto u = text(*resident<char>(csv));
+		std::string_view s(u.buf, u.len);
 
-		char rs = /*static_cast<char>*/(*_rs ? *_rs : '\n');
-		char fs = static_cast<char>(*_fs ? *_fs : ',');
-		char e = static_cast<char>(*_e ? *_e : '\\');
-		auto v = fms::char_view<const char>(h_->buf, h_->len);
+		uint64_t key = 0;
+		if (*_cache) {
+			key = cache::key(s, cache::how("timeseries", d, *pwhere));
+			if (auto m = cache::open(_cache, key)) {
+				if (auto p = cache::array(*m)) {
+					mapped = std::move(m);
 
-		unsigned r = 0;
+					return const_cast<_FPX*>(p);
+				}
+			}
+		}
+
+		fms::csv::index ix(s, d, std::thread::hardware_concurrency());
+		std::string tmp;
+
+		// skip character data
+		auto data = [&](size_t k) {
+			auto f = ix.field(s, k, 0);
+			return f.size() and std::isdigit(static_cast<unsigned char>(f.front()));
+		};
+		// field j of record k trimmed and unquoted
+		auto field = [&](size_t k, size_t j) {
+			return j < ix.fields(k) ? parse::trim(fms::csv::unquote(ix.field(s, k, j), d, tmp)) : std::string_view{};
+		};
+
+		where w(*pwhere);
+		if (!w.empty() and ix.size() and !data(0)) {
+			std::string name;
+			w.resolve(ix.fields(0), [&](size_t j) { return name.assign(field(0, j)); });
+		}
+
+		// find rows so the result is allocated once
+		std::vector<size_t> rows;
 		unsigned c = 0;
-		auto records = fms::parse::splitable<const char>(v, rs, '"', '"', e);
-		for (auto record : records) {
-			if (!std::isdigit(record.front())) {
-				continue; // skip character data
-			}
-			unsigned i = 0;
-			auto fields = fms::parse::splitable<const char>(record, fs, '"', '"', e);
-			for (auto field : fields) {
-				if (r == 0) {
-					c = static_cast<unsigned>(std::distance(fields.begin(), fields.end()));
-					ensure(i < c);
-					o.resize(1, c);
-				}
-				else if (i == 0) {
-					o.resize(r + 1, c);
-				}
-				// date or number
-				OPER f = Excel(xlfEvaluate, OPER(field.buf, field.len));
-				o(r, i) = f.as_num();
-				++i;
+		for (size_t k = 0; k < ix.size(); ++k) {
+			if (data(k) and (w.empty() or w([&](size_t j) { return field(k, j); }))) {
+				if (rows.empty()) {
+					c = static_cast<unsigned>(ix.fields(k));
+				}
+				rows.push_back(k);
+			}
+		}
+		o.resize(static_cast<unsigned>(rows.size()), c);
+
+		unsigned r = 0;
+		for (auto k : rows) {
+			auto m = static_cast<unsigned>(ix.fields(k));
+			for (unsigned i = 0; i < c; ++i) {
+				double x = std::numeric_limits<double>::quiet_NaN();
+				if (i < m) {
+					// date in the first column, then number, then anything Excel can evaluate
+					auto f = field(k, i);
+					if (!(i == 0 and fms::date::parse(f, x)) and !parse::number(f, x)) {
+						auto v = Excel(xlfEvaluate, OPER(f.data(), static_cast<unsigned>(f.size())));
+						if (v.is_num()) {
+							x = v.as_num();
+						}
+					}
+				}
+				o(r, i) = x;
 			}
 			++r;
 		}
+
+		if (*_cache and o.get()->rows and !cache::write(_cache, key, cache::file(*o.get(), key))) {
+			XLL_WARNING(__FUNCTION__ ": could not write cache file");
+		}
 	}
 	catch (const std::exception& ex) {
 		XLL_ERROR(ex.what());
@@ -209,3 +585,262 @@ _FPX* WINAPI xll_csv_parse_timeseries(HANDLEX csv, const char* _rs, const char*
 
 	return o.get();
 }
+
+#ifdef _DEBUG
+
+// about mb megabytes of CSV data having quoted fields and "\r\n" line endings
+static std::string synthetic(LONG mb)
+{
+	std::string s;
+
+	s.reserve((static_cast<size_t>(mb) << 20) + 64);
+	for (size_t i = 0; s.size() < (static_cast<size_t>(mb) << 20); ++i) {
+		s.append("2021-01-").append(std::to_string(i % 28 + 10)).append(",");
+		s.append(std::to_string(i * 7919 % 100000)).append(".25,\"quoted, field\",");
+		s.append(std::to_string(i % 97)).append("\r\n");
+	}
+
+	return s;
+}
+
+AddIn xai_csv_parse_benchmark(
+	Function(XLL_LPOPER, "xll_csv_parse_benchmark", "CSV.PARSE.BENCHMARK")
+	.Arguments({
+		Arg(XLL_LONG, "_megabytes", "is the size of the synthetic CSV data. Default is 1024."),
+		})
+	.FunctionHelp("Return GB/s of finding fields with fms::csv::tokenize and fms::parse::splitable.")
+	.Category("CSV")
+	.Documentation(R"xyzyx(
+Time splitting synthetic CSV data having quoted fields and <code>"\r\n"</code> line endings into fields.
+)xyzyx")
+);
+LPOPER WINAPI xll_csv_parse_benchmark(LONG mb)
+{
+#pragma XLLEXPORT
+	static OPER result;
+
+	try {
+		if (mb <= 0) {
+			mb = 1024;
+		}
+		auto s = synthetic(mb);
+
+		result = OPER(2, 2);
+		result(0, 0) = "fms::csv::tokenize";
+		result(0, 1) = gbs(s.size(), [&s]() {
+			size_t n = 0;
+			fms::csv::tokenize(s, fms::csv::dialect{}, [&n](size_t b, size_t e, bool) { n += e - b; });
+			return n;
+		});
+		result(1, 0) = "fms::parse::splitable";
+		result(1, 1) = gbs(s.size(), [&s]() {
+			size_t n = 0;
+			auto v = fms::char_view<const char>(s.data(), s.size());
+			for (auto record : fms::parse::splitable<const char>(v, '\n', '"', '"', '\\')) {
+				for (auto field : fms::parse::splitable<const char>(record, ',', '"', '"', '\\')) {
+					n += field.len;
+				}
+			}
+			return n;
+		});
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		result = ErrNA;
+	}
+
+	return &result;
+}
+
+AddIn xai_csv_parse_scaling(
+	Function(XLL_LPOPER, "xll_csv_parse_scaling", "CSV.PARSE.SCALING")
+	.Arguments({
+		Arg(XLL_LONG, "_megabytes", "is the size of the synthetic CSV data. Default is 256."),
+		})
+	.FunctionHelp("Return GB/s of indexing CSV data using 1 to 32 threads.")
+	.Category("CSV")
+	.Documentation(R"xyzyx(
+Time <code>fms::csv::index</code> on synthetic CSV data using 1, 2, 4, 8, 16, and 32 threads.
+The first row is the number of threads available on this machine.
+)xyzyx")
+);
+LPOPER WINAPI xll_csv_parse_scaling(LONG mb)
+{
+#pragma XLLEXPORT
+	static OPER result;
+
+	try {
+		if (mb <= 0) {
+			mb = 256;
+		}
+		auto s = synthetic(mb);
+
+		result = OPER({ OPER("hardware_concurrency"), OPER(static_cast<double>(std::thread::hardware_concurrency())) });
+		for (unsigned threads = 1; threads <= 32; threads *= 2) {
+			result.push_bottom(OPER({ OPER(static_cast<double>(threads)), OPER(gbs(s.size(), [&s, threads]() {
+				return fms::csv::index(s, fms::csv::dialect{}, threads).size();
+			})) }));
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		result = ErrNA;
+	}
+
+	return &result;
+}
+
+AddIn xai_csv_parse_rows(
+	Function(XLL_LPOPER, "xll_csv_parse_rows", "CSV.PARSE.ROWS")
+	.Arguments({
+		Arg(XLL_LONG, "_rows", "is the largest number of rows. Default is 1000000."),
+		})
+	.FunctionHelp("Return nanoseconds per row of CSV.PARSE and CSV.PARSE.TIMESERIES for 1000 to rows rows.")
+	.Category("CSV")
+	.Documentation(R"xyzyx(
+The time per row should not grow with the number of rows since the result is allocated once.
+)xyzyx")
+);
+LPOPER WINAPI xll_csv_parse_rows(LONG rows)
+{
+#pragma XLLEXPORT
+	static OPER result;
+
+	try {
+		if (rows <= 0) {
+			rows = 1000000;
+		}
+		result = OPER({ OPER("rows"), OPER("CSV.PARSE"), OPER("CSV.PARSE.TIMESERIES") });
+		OPER missing;
+		// one view of each size made on first use and reused by later calls
+		static std::map<size_t, std::string> data;
+		static std::map<size_t, HANDLEX> views;
+		for (size_t n = 1000; n <= static_cast<size_t>(rows); n *= 10) {
+			auto& h = views[n];
+			if (!h) {
+				auto& s = data[n];
+				for (size_t i = 0; i < n; ++i) {
+					s.append("2021-01-").append(std::to_string(i % 28 + 10)).append(",");
+					s.append(std::to_string(i * 7919 % 100000)).append(".25,").append(std::to_string(i % 97)).append("\n");
+				}
+				handle<fms::view<char>> h_(new shared_view<char>(std::make_shared<fms::view<char>>(s.data(), s.size())));
+				h = h_.get();
+			}
+			// rows per nanosecond
+			auto parse = gbs(n, [h, &missing]() { return xll_csv_parse(h, "", "", "", 0, 0, &missing)->size(); });
+			auto timeseries = gbs(n, [h, &missing]() { return xll_csv_parse_timeseries(h, "", "", "", &missing, "")->rows; });
+			result.push_bottom(OPER({ OPER(static_cast<double>(n)), OPER(1 / parse), OPER(1 / timeseries) }));
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		result = ErrNA;
+	}
+
+	return &result;
+}
+
+Auto<OpenAfter> xaoa_csv_parse_test([]() {
+	try {
+		ensure(0 == fms::csv::test());
+		ensure(0 == parse::test());
+		ensure(0 == fms::date::test());
+
+		static char csv[] = "\xEF\xBB\xBF" "a,b\r\n1,\"x,\"\"y\"\r\n2,z\\,w";
+		handle<fms::view<char>> h_(new shared_view<char>(std::make_shared<fms::view<char>>(csv, sizeof(csv) - 1)));
+		OPER missing;
+		OPER o = *xll_csv_parse(h_.get(), "", "", "", 0, 0, &missing);
+		ensure(o.rows() == 3 and o.columns() == 2);
+		ensure(o(0, 0) == "a" and o(0, 1) == "b");
+		ensure(o(1, 1) == "x,\"y");
+		ensure(o(2, 1) == "z,w");
+
+		OPER cols({ OPER("b"), OPER(2) });
+		o = *xll_csv_parse(h_.get(), "", "", "", 1, 1, &cols);
+		ensure(o.rows() == 1 and o.columns() == 2);
+		ensure(o(0, 0) == "x,\"y" and o(0, 1) == OPER(ErrNA));
+		o = *xll_csv_parse(h_.get(), "", "", "", 3, 0, &missing);
+		ensure(o == OPER(ErrNA));
+
+		// ropes and contiguous views give the same records
+		static char whole[] = "\xEF\xBB\xBF" "a,b\n\n1,2\n3,4\n";
+		handle<fms::view<char>> w_(new shared_view<char>(std::make_shared<fms::view<char>>(whole, sizeof(whole) - 1)));
+		auto r = new rope_view<char>;
+		r->append(*shared<char>(w_.get()), 0, 9);
+		r->append(*shared<char>(w_.get()), 9, sizeof(whole) - 1 - 9);
+		handle<fms::view<char>> r_(r);
+		for (LONG off : { 0, 1, 2 }) {
+			for (LONG n : { 0, 1, 2 }) {
+				OPER x = *xll_csv_parse(w_.get(), "", "", "", off, n, &missing);
+				ensure(x == *xll_csv_parse(r_.get(), "", "", "", off, n, &missing));
+			}
+		}
+		o = *xll_csv_parse(r_.get(), "", "", "", 0, 0, &missing);
+		ensure(o.rows() == 4 and o(0, 0) == "a" and o(1, 0) == "" and o(2, 1) == "2");
+
+		static char semi[] = "x;y\r\n1;'a;b'\r\n2;c\r\n";
+		handle<fms::view<char>> s_(new shared_view<char>(std::make_shared<fms::view<char>>(semi, sizeof(semi) - 1)));
+		o = *xll_csv_sniff(s_.get());
+		ensure(o(1, 1) == ";" and o(3, 1) == "'" and o(4, 1) == OPER(true) and o(5, 1) == OPER(true));
+		o = *xll_csv_parse(s_.get(), "", "auto", "", 0, 0, &missing);
+		ensure(o.rows() == 3 and o.columns() == 2 and o(1, 1) == "a;b");
+		// ropes are sniffed across segments
+		auto rs = new rope_view<char>;
+		rs->append(*shared<char>(s_.get()), 0, 2);
+		rs->append(*shared<char>(s_.get()), 2, sizeof(semi) - 1 - 2);
+		handle<fms::view<char>> rs_(rs);
+		o = *xll_csv_sniff(rs_.get());
+		ensure(o(1, 1) == ";" and o(3, 1) == "'" and o(4, 1) == OPER(true) and o(5, 1) == OPER(true));
+
+		static char ts[] = "date,px\r\n2021-01-04,1.5\r\n2021-01-05,2\r\n";
+		handle<fms::view<char>> t_(new shared_view<char>(std::make_shared<fms::view<char>>(ts, sizeof(ts) - 1)));
+		const auto& a = *xll_csv_parse_timeseries(t_.get(), "", "", "", &missing, "");
+		ensure(a.rows == 2 and a.columns == 2);
+		ensure(a.array[0] == 44200 and a.array[1] == 1.5 and a.array[3] == 2);
+
+		static char sym[] = "date,sym,px\n2021-01-04,IBM,1\n2021-01-04,\"MSFT\",2\n2021-01-05,IBM,3\n2021-01-06,AAPL,4\n2021-01-07,MSFT,5\n";
+		handle<fms::view<char>> y_(new shared_view<char>(std::make_shared<fms::view<char>>(sym, sizeof(sym) - 1)));
+		OPER w({ OPER(0.), OPER("between"), OPER("2021-01-04"), OPER(44202.) });
+		w.push_bottom(OPER({ OPER("sym"), OPER("in"), OPER("MSFT"), OPER("AAPL") }));
+		const auto& b = *xll_csv_parse_timeseries(y_.get(), "", "", "", &w, "");
+		ensure(b.rows == 2 and b.columns == 3);
+		ensure(b.array[0] == 44200 and b.array[2] == 2);
+		ensure(b.array[3] == 44202 and b.array[5] == 4);
+		w = OPER({ OPER(2.), OPER(">"), OPER(4.) });
+		ensure(xll_csv_parse_timeseries(y_.get(), "", "", "", &w, "")->rows == 1);
+		// values for a named date column are dates
+		w = OPER({ OPER("date"), OPER("Between"), OPER("20210105"), OPER("20210106") });
+		const auto& c = *xll_csv_parse_timeseries(y_.get(), "", "", "", &w, "");
+		ensure(c.rows == 2 and c.array[0] == 44201 and c.array[3] == 44202);
+		w = OPER({ OPER("date"), OPER(">="), OPER("20210107") });
+		ensure(xll_csv_parse_timeseries(y_.get(), "", "", "", &w, "")->rows == 1);
+
+		// the second call returns the result mapped from the cache without parsing
+		char path[MAX_PATH];
+		auto n = GetTempPathA(MAX_PATH, path);
+		ensure(n and n + 64 < MAX_PATH);
+		strcat_s(path, "xll_csv_timeseries_test.cache");
+		cache::remove(path);
+		auto p = xll_csv_parse_timeseries(y_.get(), "", "", "", &w, path);
+		ensure(p->rows == 1 and p->columns == 3 and p->array[2] == 5);
+		auto q = xll_csv_parse_timeseries(y_.get(), "", "", "", &w, path);
+		ensure(q != p and reinterpret_cast<uintptr_t>(q) % fms::columns::align == 0);
+		ensure(q->rows == 1 and q->columns == 3 and q->array[0] == 44203 and q->array[2] == 5);
+		// other predicates replace the cache
+		ensure(xll_csv_parse_timeseries(y_.get(), "", "", "", &missing, path)->rows == 5);
+		q = xll_csv_parse_timeseries(y_.get(), "", "", "", &missing, path);
+		ensure(q->rows == 5 and q->columns == 3 and q->array[14] == 5);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return FALSE;
+	}
+
+	return TRUE;
+});
+
+#endif // _DEBUG
@@ -2,6 +2,7 @@
 #include <thread>
 #include "xll_inet.h"
 #include "fms_parse/win_mem_view.h"
+#include "xll_view.h"
 
 using namespace xll;
 
@@ -371,7 +372,7 @@ HANDLEX WINAPI xll_inet_open_url(LPCTSTR url, LPOPER pheaders, LONG flags)
         OPER head = OPER("User-Agent: " USER_AGENT "\r\n");
         head.append(headers(*pheaders));
         
-        handle<Inet::HInet> hurl(new Inet::HInet(InternetOpenUrl(Inet::hInet, url, head.val.str + 1, head.val.str[0], flags, context)));
+        handle<Inet::OpenUrl> hurl(new Inet::OpenUrl(InternetOpenUrl(Inet::hInet, url, head.val.str + 1, head.val.str[0], flags, context)));
         h = hurl.get();
     }
     catch (const std::exception& ex) {
@@ -381,17 +382,26 @@ HANDLEX WINAPI xll_inet_open_url(LPCTSTR url, LPOPER pheaders, LONG flags)
     return h;
 }
 
+// header value or #VALUE! if it is longer than a cell can hold
+static OPER header_value(std::string_view value)
+{
+    return value.size() <= traits<XLOPERX>::charmax ? OPER(value.data(), static_cast<unsigned>(value.size())) : OPER(ErrValue);
+}
+
 AddIn xai_http_query_info(
     Function(XLL_LPOPER, "xll_http_query_info", "HTTP.QUERY_INFO")
     .Arguments({
         Arg(XLL_HANDLEX, "handle", "is a handle returned by \\INET.OPEN_URL."),
-        Arg(XLL_LPOPER, "info", "is a combination of HTTP_QUERY_* attributes."),
+        Arg(XLL_LPOPER, "info", "is a combination of HTTP_QUERY_* attributes or a header name."),
         })
     .FunctionHelp("Return substring of view.")
     .Category(CATEGORY)
     .HelpTopic("https://docs.microsoft.com/en-us/windows/win32/api/wininet/nf-wininet-httpqueryinfoa")
     .Documentation(R"xyzyx(
 Retrieve header information associated with an HTTP request.
+If <code>info</code> is a string then the values of that header are returned
+from the headers cached on the handle.
+A value longer than a cell can hold is returned as <code>#VALUE!</code>.
 )xyzyx")
 );
 LPOPER WINAPI xll_http_query_info(HANDLEX h, LPOPER pinfo)
@@ -400,26 +410,30 @@ LPOPER WINAPI xll_http_query_info(HANDLEX h, LPOPER pinfo)
     static OPER result;
 
     try {
-        handle<Inet::HInet> h_(h);
+        handle<Inet::OpenUrl> h_(h);
         ensure(h_);
 
         if (pinfo->is_num()) {
             DWORD info = static_cast<DWORD>(pinfo->val.num);
-            DWORD size = 0;
-            HttpQueryInfo(*h_, info, (LPVOID)nullptr, &size, NULL);
-            result = OPER(_T(""), size);
-            HttpQueryInfo(*h_, info, (LPVOID)&result.val.str[1], &size, NULL);
-            ensure(size <= traits<XLOPERX>::charmax);
-            result.val.str[0] = static_cast<TCHAR>(size);
+            // one call, size is in bytes not including the terminating null
+            static TCHAR buf[traits<XLOPERX>::charmax + 1];
+            DWORD size = sizeof(buf);
+            ensure(HttpQueryInfo(*h_, info, (LPVOID)buf, &size, NULL));
+            result = OPER(buf, static_cast<TCHAR>(size / sizeof(TCHAR)));
         }
         else if (pinfo->is_str()) {
             // custom header
-            DWORD size = pinfo->val.str[0];
-            HttpQueryInfo(*h_, HTTP_QUERY_CUSTOM, (LPVOID)&pinfo->val.str[1], &size, NULL);
-            result = OPER(pinfo->val.str + 1, size);
-            HttpQueryInfo(*h_, HTTP_QUERY_CUSTOM, (LPVOID)&result.val.str[1], &size, NULL);
-            ensure(size <= traits<XLOPERX>::charmax);
-            result.val.str[0] = static_cast<TCHAR>(size);
+            // header names are ASCII
+            std::string name(pinfo->val.str[0], 0);
+            for (unsigned i = 0; i < name.size(); ++i) {
+                name[i] = static_cast<char>(pinfo->val.str[i + 1]);
+            }
+            if (h_->headers().count(name)) {
+                result = header_value(h_->headers().value(name));
+            }
+            else {
+                result = ErrNA;
+            }
         }
         else {
             ensure(!__FUNCTION__ ": expecting a numerical or string info argument");
@@ -434,24 +448,86 @@ LPOPER WINAPI xll_http_query_info(HANDLEX h, LPOPER pinfo)
     return &result;
 }
 
+AddIn xai_http_headers(
+    Function(XLL_LPOPER, "xll_http_headers", "HTTP.HEADERS")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\INET.OPEN_URL."),
+        })
+    .FunctionHelp("Return all response headers as a two column range.")
+    .Category(CATEGORY)
+    .HelpTopic("https://docs.microsoft.com/en-us/windows/win32/api/wininet/nf-wininet-httpqueryinfoa")
+    .Documentation(R"xyzyx(
+Return header names in the first column and values in the second column
+in the order they were received. Headers are read from the server
+once per handle and cached for subsequent calls to <code>HTTP.QUERY_INFO</code>.
+A value longer than a cell can hold is returned as <code>#VALUE!</code>.
+)xyzyx")
+);
+LPOPER WINAPI xll_http_headers(HANDLEX h)
+{
+#pragma XLLEXPORT
+    static OPER result;
+
+    try {
+        handle<Inet::OpenUrl> h_(h);
+        ensure(h_);
+
+        const auto& fields = h_->headers().fields();
+        ensure(fields.size() || !__FUNCTION__ ": no headers");
+
+        result = OPER(static_cast<unsigned>(fields.size()), 2);
+        for (unsigned i = 0; i < result.rows(); ++i) {
+            const auto& [name, value] = fields[i];
+            result(i, 0) = OPER(name.data(), static_cast<unsigned>(name.size()));
+            result(i, 1) = header_value(value);
+        }
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        result = ErrNA;
+    }
+
+    return &result;
+}
+
+#ifdef _DEBUG
+
+Auto<OpenAfter> xaoa_http_headers_test([]() {
+    try {
+        fms::http::headers h("HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/csv; charset=utf-8\r\n"
+            "Set-Cookie: a=1\r\n"
+            "set-cookie: b=2\r\n"
+            "\r\n");
+        ensure(h.status() == "HTTP/1.1 200 OK");
+        ensure(h.size() == 3);
+        ensure(*h.find("content-type") == "text/csv; charset=utf-8");
+        ensure(h.count("SET-COOKIE") == 2);
+        ensure(h.value("Set-Cookie") == "a=1, b=2");
+        ensure(!h.find("Content-Length"));
+        ensure(fms::charset::parameter(*h.find("content-type")) == "utf-8");
+
+        ensure(0 == fms::charset::test());
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        return FALSE;
+    }
+
+    return TRUE;
+});
+
+#endif // _DEBUG
+
 // return data in a view
-void url_view(LPCTSTR url, LPOPER pheaders, LONG flags, fms::view<char>& h)
+void url_view(LPCTSTR url, LPOPER pheaders, LONG flags, body& h)
 {
-    DWORD_PTR context = NULL;
     OPER head = OPER("User-Agent: " USER_AGENT "\r\n");
     head.append(headers(*pheaders));
-    Inet::HInet hurl(InternetOpenUrl(Inet::hInet, url, head.val.str + 1, head.val.str[0], flags, context));
-    ensure(hurl || !__FUNCTION__ ": failed to open URL");
 
-    DWORD len;
-    if (!InternetQueryDataAvailable(hurl, &len, 0, 0)) {
-        len = 4096; // ??? page size
-    }
-    char* buf = h.buf;
-    while (InternetReadFile(hurl, buf, len, &len) and len != 0) {
-        h.len += len;
-        buf += len;
-    }
+    h.charset = Inet::read_url(url, head.val.str + 1, head.val.str[0], flags, h);
 }
 
 AddIn xai_inet_read_file(
@@ -472,6 +548,17 @@ and
 <p>
 Headers are specified as a two column array of keys in the first row and values in the second.
 </p>
+<p>
+If <code>INET.PREFETCH(TRUE)</code> was called and <code>url</code> was produced by
+a URL builder such as <code>YAHOO.FINANCE</code> or <code>EOD.HISTORICAL</code> then
+the data already read, or being read, in the background is used.
+</p>
+<p>
+The data is converted to UTF-8 as it is read if the <code>Content-Type</code> header has a
+<code>charset</code> of windows-1252, ISO-8859-1, or UTF-16, or the <code>Content-Type</code> is
+text, JSON, or XML and the data starts with a UTF-16 byte order mark.
+At most 128 MB of UTF-8 is read.
+</p>
 )xyzyx")
 );
 HANDLEX WINAPI xll_inet_read_file(LPCTSTR url, LPOPER pheaders, LONG flags)
@@ -480,10 +567,17 @@ HANDLEX WINAPI xll_inet_read_file(LPCTSTR url, LPOPER pheaders, LONG flags)
     HANDLEX h = INVALID_HANDLEX;
 
     try {
-        handle<fms::view<char>> h_(new win::mem_view<char>);
-  
-        url_view(url, pheaders, flags, *h_);
-  
+        Inet::prefetch::view v;
+        if ((pheaders->is_missing() or pheaders->is_nil()) and flags == 0) {
+            v = Inet::prefetcher.take(url);
+        }
+        if (!v) {
+            v.reset(new body);
+            url_view(url, pheaders, flags, *v);
+        }
+
+        handle<fms::view<char>> h_(new shared_view<char>(std::move(v)));
+
         h = h_.get();
     }
     catch (const std::exception& ex) {
@@ -493,111 +587,85 @@ HANDLEX WINAPI xll_inet_read_file(LPCTSTR url, LPOPER pheaders, LONG flags)
     return h;
 }
 
-#if 0
-AddIn xai_mem_view_(
-    Function(XLL_HANDLEX, "xll_mem_view_", "\\MEM_VIEW")
+AddIn xai_inet_prefetch(
+    Function(XLL_BOOL, "xll_inet_prefetch", "INET.PREFETCH")
     .Arguments({
-        Arg(XLL_LONG, "n", "allocate 2^n bytes initially. Default = 20.")
+        Arg(XLL_LPOPER, "_enable", "is an optional boolean to turn prefetching on or off."),
         })
-    .Uncalced()
     .Category(CATEGORY)
-    .FunctionHelp("Return a handle to a view of memory.")
+    .FunctionHelp("Speculatively read URLs returned by URL builder functions.")
     .Documentation(R"xyzyx(
-Return handle to memory mapped file.
+When prefetching is enabled, functions that return URLs such as <code>YAHOO.FINANCE</code>
+and <code>EOD.HISTORICAL</code> start reading the URL in the background as soon as it is built.
+A dependent <code>\URL.VIEW</code> having no headers or flags uses the data that
+has been read instead of reading the URL again.
+Turning prefetching off cancels any pending reads.
+If <code>_enable</code> is missing the current state is returned.
 )xyzyx")
 );
-HANDLEX WINAPI xll_mem_view_(LONG n)
+BOOL WINAPI xll_inet_prefetch(LPOPER penable)
 {
-    HANDLEX h = INVALID_HANDLEX;
-    
+#pragma XLLEXPORT
+    BOOL b = FALSE;
+
     try {
-        if (n == 0) {
-            n = 20;
+        if (penable->is_missing()) {
+            b = Inet::prefetcher.is_enabled();
+        }
+        else {
+            b = Inet::prefetcher.enable(!!*penable);
         }
-        handle<fms::view<char>> h_(new win::mem_view<char>(INVALID_HANDLE_VALUE, 1 << n));
-        h = h_.get();
     }
     catch (const std::exception& ex) {
         XLL_ERROR(ex.what());
     }
 
-    return h;
+    return b;
 }
 
-AddIn xai_inet_viewa(
-    Function(XLL_VOID, "xll_inet_viewa", "URL.VIEWA")
+// join background reads before the DLL is unloaded
+Auto<Close> xac_inet_prefetch([]() {
+    Inet::prefetcher.stop();
+
+    return TRUE;
+});
+
+AddIn xai_inet_timings(
+    Function(XLL_LPOPER, "xll_inet_timings", "INET.TIMINGS")
     .Arguments({
-        Arg(XLL_HANDLEX, "h", "is a handle returned by \\MEM_VIEW."),
-        Arg(XLL_CSTRING, "url", "is a URL to read."),
-        Arg(XLL_LPOPER, "_headers", "are optional headers to send to the HTTP server."),
-        Arg(XLL_LONG, "_flags", "are optional flags from INTERNET_FLAGS_*. Default is 0.")
+        Arg(XLL_BOOL, "_clear", "is an optional boolean indicating the timings should be cleared."),
         })
-    .Asynchronous()
+    .Volatile()
     .Category(CATEGORY)
-    .FunctionHelp("Asynchronously return a handle to the string returned by url.")
+    .FunctionHelp("Return the time taken by each phase of recent URL reads.")
     .Documentation(R"xyzyx(
-Read all url data into memory using
-<a href="https://docs.microsoft.com/en-us/windows/win32/api/wininet/nf-wininet-internetopenurla">InternetOpenUrl</a>
-and
-<a href="https://docs.microsoft.com/en-us/windows/win32/api/wininet/nf-wininet-internetreadfile">InternetReadFile</a>.
+Return a range with one row per URL read, most recent last, having columns
+<code>url</code>, <code>open</code>, <code>first</code>, <code>total</code>, and <code>bytes</code>.
+Times are in milliseconds. The <code>open</code> time includes resolving the host name,
+connecting, the TLS handshake, sending the request, and receiving the response headers.
+The <code>first</code> time is the wait for the first byte of the body
+and <code>total</code> is the time from open to the last byte.
 <p>
-Headers are specified as a two column array of keys in the first row and values in the second.
+All reads share one WinInet session that caches DNS answers, keeps connections
+alive, and resumes TLS sessions, so repeated reads from the same host
+should show a smaller <code>open</code> time.
 </p>
 )xyzyx")
 );
-void WINAPI xll_inet_viewa(HANDLEX h, LPCTSTR url, LPOPER pheaders, LONG flags, LPXLOPERX phandle)
-{
-#pragma XLLEXPORT
-    try {
-        handle<fms::view<char>> h_(h);
-        {
-            std::jthread jt([&url, &pheaders, &flags, &h_]() { return url_view(url, pheaders, flags, *h_); });
-        }
-        Excel(xlAsyncReturn, OPER(h_.get()), *phandle);
-    }
-    catch (const std::exception& ex) {
-        XLL_ERROR(ex.what());
-    }
-}
-#endif // 0
-AddIn xai_view(
-    Function(XLL_LPOPER, "xll_view", "VIEW")
-    .Arguments({
-        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\URL.VIEW."),
-        Arg(XLL_LONG, "_offset", "is the view offset. Default is 0."),
-        Arg(XLL_LONG, "_count", "is the number of characters to return. Default is all.")
-        })
-    .FunctionHelp("Return substring of view.")
-    .Category(CATEGORY)
-    .Documentation(R"xyzyx(
-Drop <code>_offset</code> and take <code>_count</code> charaters from a view.
-If <code>_count</code> is a string then the view is truncated at the
-first character of this string if offset is positive. If offset is negative
-the all characters up to the last occurence are taken.
-)xyzyx")
-);
-LPOPER WINAPI xll_view(HANDLEX h, LONG off, LONG len)
+LPOPER WINAPI xll_inet_timings(BOOL clear)
 {
 #pragma XLLEXPORT
     static OPER result;
 
     try {
-        handle<fms::view<char>> v(h);
-        ensure(v || !__FUNCTION__ ": unrecognized handle");
-
-        if (v->len > 3 and v->buf[0] == 0xEF) {
-            ensure(v->buf[1] == 0xBB and v->buf[2] == 0xBF || !"VIEW: does not start with UTF-8 BOM");
-            v->drop(3);
-        }
-
-        if (off > v->len) {
-            off = v->len - 1;
+        result = OPER({ OPER("url"), OPER("open"), OPER("first"), OPER("total"), OPER("bytes") });
+        for (const auto& t : Inet::timer.copy()) {
+            OPER row({ OPER(t.url.c_str()), OPER(t.open), OPER(t.first), OPER(t.total), OPER(static_cast<double>(t.bytes)) });
+            result.push_bottom(row);
         }
-        if (off + len > v->len) {
-            len = v->len - off - 1;
+        if (clear) {
+            Inet::timer.clear();
         }
-
-        result = OPER(v->buf + off, len);
     }
     catch (const std::exception& ex) {
         XLL_ERROR(ex.what());
@@ -608,70 +676,73 @@ LPOPER WINAPI xll_view(HANDLEX h, LONG off, LONG len)
     return &result;
 }
 
-AddIn xai_view_len(
-    Function(XLL_LPOPER, "xll_view_len", "VIEW.LEN")
+#if 0
+AddIn xai_mem_view_(
+    Function(XLL_HANDLEX, "xll_mem_view_", "\\MEM_VIEW")
     .Arguments({
-        Arg(XLL_HANDLEX, "handle", "is a handle to a view of memory."),
+        Arg(XLL_LONG, "n", "allocate 2^n bytes initially. Default = 20.")
         })
-    .FunctionHelp("Return the number of characters in a view.")
+    .Uncalced()
     .Category(CATEGORY)
+    .FunctionHelp("Return a handle to a view of memory.")
     .Documentation(R"xyzyx(
-The function <code>\INET.READ</code> returns a view.
+Return handle to memory mapped file.
 )xyzyx")
 );
-LPOPER WINAPI xll_view_len(HANDLEX h)
+HANDLEX WINAPI xll_mem_view_(LONG n)
 {
-#pragma XLLEXPORT
-    static OPER result;
-
+    HANDLEX h = INVALID_HANDLEX;
+    
     try {
-        handle<fms::view<char>> h_(h);
-        ensure(h_ || !"VIEW.LEN: unrecognized handle");
-
-        result = h_->len;
+        if (n == 0) {
+            n = 20;
+        }
+        handle<fms::view<char>> h_(new win::mem_view<char>(INVALID_HANDLE_VALUE, 1 << n));
+        h = h_.get();
     }
     catch (const std::exception& ex) {
         XLL_ERROR(ex.what());
-
-        result = ErrNA;
     }
 
-    return &result;
+    return h;
 }
 
-AddIn xai_view_drop(
-    Function(XLL_HANDLEX, "xll_view_drop", "VIEW.DROP")
+AddIn xai_inet_viewa(
+    Function(XLL_VOID, "xll_inet_viewa", "URL.VIEWA")
     .Arguments({
-        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\URL.VIEW."),
-        Arg(XLL_LONG, "count", "number or characters to drop from beginning (count > 0) or end (count < 0) of view"),
+        Arg(XLL_HANDLEX, "h", "is a handle returned by \\MEM_VIEW."),
+        Arg(XLL_CSTRING, "url", "is a URL to read."),
+        Arg(XLL_LPOPER, "_headers", "are optional headers to send to the HTTP server."),
+        Arg(XLL_LONG, "_flags", "are optional flags from INTERNET_FLAGS_*. Default is 0.")
         })
-    .FunctionHelp("Return handle with dropped characters.")
+    .Asynchronous()
     .Category(CATEGORY)
+    .FunctionHelp("Asynchronously return a handle to the string returned by url.")
     .Documentation(R"xyzyx(
-Drop from the beginning if <code>count > 0</code>
-or end if <code>count < 0</code> of view.
+Read all url data into memory using
+<a href="https://docs.microsoft.com/en-us/windows/win32/api/wininet/nf-wininet-internetopenurla">InternetOpenUrl</a>
+and
+<a href="https://docs.microsoft.com/en-us/windows/win32/api/wininet/nf-wininet-internetreadfile">InternetReadFile</a>.
+<p>
+Headers are specified as a two column array of keys in the first row and values in the second.
+</p>
 )xyzyx")
 );
-HANDLEX WINAPI xll_view_drop(HANDLEX h, LONG count)
+void WINAPI xll_inet_viewa(HANDLEX h, LPCTSTR url, LPOPER pheaders, LONG flags, LPXLOPERX phandle)
 {
 #pragma XLLEXPORT
-    static OPER result;
-
     try {
         handle<fms::view<char>> h_(h);
-        ensure(h_ || !"VIEW.DROP: unrecognized handle");
-
-        h_->drop(count);
+        {
+            std::jthread jt([&url, &pheaders, &flags, &h_]() { return url_view(url, pheaders, flags, *h_); });
+        }
+        Excel(xlAsyncReturn, OPER(h_.get()), *phandle);
     }
     catch (const std::exception& ex) {
         XLL_ERROR(ex.what());
-
-        h = 0;
     }
-
-    return h;
 }
-
+#endif // 0
 #if 0
 // up to 254 instances of split buffers
 static unsigned int buf_index = 0;
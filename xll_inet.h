@@ -1,8 +1,21 @@
 // xll_inet.h - https://docs.microsoft.com/en-us/windows/win32/wininet/about-wininet
 #pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
 #include "xll/xll/xll.h"
 #include "xll/xll/win.h"
 #include <wininet.h>
+#include "fms_parse/win_mem_view.h"
+#include "fms_charset.h"
+#include "fms_http.h"
+#include "xll_view.h"
 
 #pragma comment(lib, "Wininet.lib")
 
@@ -15,6 +28,7 @@
 #endif
 
 #define USER_AGENT "Mozilla/5.0 (Windows NT) Gecko/20100101 Firefox/89.0"
+#define USER_AGENT_HEADER _T("User-Agent: " USER_AGENT "\r\n")
 
 // Define name with description. Define XLL_CATEGORY and XLL_TOPIC before using
 #define XLL_CONST_DEFAULT(name, desc) XLL_CONST(LONG, ##name, ##name, desc, XLL_CATEGORY, XLL_TOPIC)
@@ -167,4 +181,320 @@ namespace Inet {
 
 	inline HInet hInet = InternetOpen(_T("Xll_" CATEGORY), INTERNET_OPEN_TYPE_DIRECT, NULL, NULL, 0);
 
+	// Wall clock milliseconds for each phase of reading a URL.
+	// WinInet keeps connections alive, caches DNS answers, and resumes TLS sessions
+	// per InternetOpen handle so repeated reads from a host show a smaller open time.
+	struct timing {
+		std::basic_string<TCHAR> url;
+		double open;  // resolve, connect, handshake, send request, and receive headers
+		double first; // wait for first byte of the body
+		double total; // open to last byte
+		size_t bytes;
+	};
+
+	// most recent timings
+	class timings {
+		std::mutex mutex;
+		std::deque<timing> log;
+	public:
+		static constexpr size_t max_log = 256;
+
+		void push(timing&& t)
+		{
+			std::lock_guard lock(mutex);
+
+			if (log.size() == max_log) {
+				log.pop_front();
+			}
+			log.push_back(std::move(t));
+		}
+		std::vector<timing> copy()
+		{
+			std::lock_guard lock(mutex);
+
+			return std::vector<timing>(log.begin(), log.end());
+		}
+		void clear()
+		{
+			std::lock_guard lock(mutex);
+
+			log.clear();
+		}
+	};
+
+	inline timings timer;
+
+	// Content-Type header or empty if none
+	inline std::string content_type(HINTERNET h)
+	{
+		DWORD size = 256;
+		std::string type(size, 0);
+		if (!HttpQueryInfoA(h, HTTP_QUERY_CONTENT_TYPE, type.data(), &size, NULL)) {
+			if (GetLastError() != ERROR_INSUFFICIENT_BUFFER) {
+				return std::string{};
+			}
+			type.resize(size);
+			if (!HttpQueryInfoA(h, HTTP_QUERY_CONTENT_TYPE, type.data(), &size, NULL)) {
+				return std::string{};
+			}
+		}
+		type.resize(size);
+
+		return type;
+	}
+
+	// Call f(buf, len) with each chunk of url data in UTF-8 until f returns false.
+	// Bodies having a Content-Type charset for another encoding are transcoded
+	// as they are read, as are text, JSON, or XML bodies starting with a UTF-16
+	// byte order mark. Return the original encoding.
+	template<class F>
+	inline fms::charset::encoding read_url(HINTERNET session, LPCTSTR url, LPCTSTR head, DWORD headlen, LONG flags, F&& f)
+	{
+		using clock = std::chrono::steady_clock;
+		auto ms = [](clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+		auto t0 = clock::now();
+		DWORD_PTR context = NULL;
+		HInet hurl(InternetOpenUrl(session, url, head, headlen, flags, context));
+		ensure(hurl || !__FUNCTION__ ": failed to open URL");
+		auto t1 = clock::now();
+		auto t2 = t1;
+		auto type = content_type(hurl);
+		fms::charset::decoder utf8(fms::charset::label(fms::charset::parameter(type)), fms::charset::textual(type));
+
+		static constexpr DWORD size = 1 << 16;
+		std::unique_ptr<char[]> buf(new char[size]);
+		size_t bytes = 0;
+		DWORD len;
+		bool more = true;
+		while (more and InternetReadFile(hurl, buf.get(), size, &len) and len != 0) {
+			if (bytes == 0) {
+				t2 = clock::now();
+			}
+			bytes += len;
+			auto u = utf8(std::string_view(buf.get(), len));
+			more = u.empty() or f(u.data(), static_cast<DWORD>(u.size()));
+		}
+		if (more) {
+			if (auto u = utf8.finish(); u.size()) {
+				f(u.data(), static_cast<DWORD>(u.size()));
+			}
+		}
+
+		timer.push(timing{ url, ms(t1 - t0), ms(t2 - t1), ms(clock::now() - t0), bytes });
+
+		return utf8.source();
+	}
+
+	template<class F>
+	inline fms::charset::encoding read_url(LPCTSTR url, LPCTSTR head, DWORD headlen, LONG flags, F&& f)
+	{
+		return read_url(hInet, url, head, headlen, flags, std::forward<F>(f));
+	}
+
+	// Append all url data to v. Transcoding can make the data up to three
+	// times longer than what was read so each chunk is checked against what is left.
+	inline fms::charset::encoding read_url(HINTERNET session, LPCTSTR url, LPCTSTR head, DWORD headlen, LONG flags, xll::body& v)
+	{
+		return read_url(session, url, head, headlen, flags, [&v](const char* buf, DWORD len) {
+			ensure(static_cast<size_t>(len) <= xll::body::capacity - static_cast<size_t>(v.len)
+				|| !__FUNCTION__ ": data is larger than the memory reserved for it");
+			memcpy(v.buf + v.len, buf, len);
+			v.len += len;
+
+			return true;
+		});
+	}
+	inline fms::charset::encoding read_url(LPCTSTR url, LPCTSTR head, DWORD headlen, LONG flags, xll::body& v)
+	{
+		return read_url(hInet, url, head, headlen, flags, v);
+	}
+
+	// Speculative background reads of URLs produced by URL builder functions.
+	// \URL.VIEW takes ownership of a pending read instead of reading the url again.
+	// Reads use their own session so closing it cancels them. Every read is
+	// joined by enable(false) or stop(), which xlAutoClose calls before unloading.
+	class prefetch {
+	public:
+		using string = std::basic_string<TCHAR>;
+		using view = std::unique_ptr<xll::body>;
+		static constexpr size_t max_pending = 64;
+	private:
+		struct read {
+			std::thread worker;
+			view v; // null if the read failed
+			bool done = false;
+		};
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::map<string, std::shared_ptr<read>> pending;
+		std::deque<string> order; // oldest first
+		std::vector<std::shared_ptr<read>> evicted; // joined when done
+		HINTERNET session = NULL;
+		bool enabled = false;
+
+		// join evicted reads that have finished
+		void reap()
+		{
+			std::erase_if(evicted, [](const auto& r) {
+				if (!r->done) {
+					return false;
+				}
+				r->worker.join();
+
+				return true;
+			});
+		}
+		// close the session to cancel reads in progress and wait for them
+		void cancel(std::unique_lock<std::mutex>& lock)
+		{
+			if (session) {
+				InternetCloseHandle(session);
+				session = NULL;
+			}
+			std::vector<std::shared_ptr<read>> reads;
+			reads.swap(evicted);
+			for (auto& [url, r] : pending) {
+				reads.push_back(r);
+			}
+			pending.clear();
+			order.clear();
+
+			lock.unlock(); // workers take the lock to finish
+			for (auto& r : reads) {
+				r->worker.join();
+			}
+			lock.lock();
+		}
+	public:
+		prefetch() = default;
+		prefetch(const prefetch&) = delete;
+		prefetch& operator=(const prefetch&) = delete;
+
+		bool enable(bool b)
+		{
+			std::unique_lock lock(mutex);
+
+			if (b and !enabled) {
+				session = InternetOpen(_T("Xll_" CATEGORY), INTERNET_OPEN_TYPE_DIRECT, NULL, NULL, 0);
+				ensure(session || !__FUNCTION__ ": InternetOpen failed");
+			}
+			else if (!b and enabled) {
+				cancel(lock);
+			}
+			enabled = b;
+
+			return enabled;
+		}
+		// cancel and join all reads
+		void stop()
+		{
+			enable(false);
+		}
+		bool is_enabled()
+		{
+			std::lock_guard lock(mutex);
+
+			return enabled;
+		}
+		// start reading url in the background if enabled and not already pending
+		void fetch(const string& url)
+		{
+			std::lock_guard lock(mutex);
+
+			reap();
+			if (!enabled or url.empty() or pending.contains(url)) {
+				return;
+			}
+			if (pending.size() == max_pending) {
+				auto i = pending.find(order.front());
+				evicted.push_back(i->second);
+				pending.erase(i);
+				order.pop_front();
+			}
+			auto r = std::make_shared<read>();
+			r->worker = std::thread([this, r, url, session = session]() {
+				view v(new xll::body);
+				try {
+					v->charset = read_url(session, url.c_str(), USER_AGENT_HEADER, static_cast<DWORD>(-1L), 0, *v);
+				}
+				catch (const std::exception&) {
+					v.reset(); // caller reads url
+				}
+				std::lock_guard lock(mutex);
+				r->v = std::move(v);
+				r->done = true;
+				cv.notify_all();
+			});
+			pending.emplace(url, r);
+			order.push_back(url);
+		}
+		// view of url waiting for the read to finish or nullptr if not prefetched or failed
+		view take(const string& url)
+		{
+			std::unique_lock lock(mutex);
+
+			auto i = pending.find(url);
+			if (i == pending.end()) {
+				return nullptr;
+			}
+			auto r = i->second;
+			pending.erase(i);
+			std::erase(order, url);
+
+			cv.wait(lock, [&r]() { return r->done; });
+			lock.unlock();
+			r->worker.join();
+
+			return std::move(r->v);
+		}
+	};
+
+	inline prefetch prefetcher;
+
+	// hand a URL built in a cell to the prefetcher
+	inline void prefetch_url(const xll::OPER& url)
+	{
+		if (url.is_str() and prefetcher.is_enabled()) {
+			prefetcher.fetch(prefetch::string(url.val.str + 1, url.val.str[0]));
+		}
+	}
+
+	// all response headers in one call
+	inline std::string raw_headers(HINTERNET h)
+	{
+		DWORD size = 4096;
+		std::string raw(size, 0);
+		if (!HttpQueryInfoA(h, HTTP_QUERY_RAW_HEADERS_CRLF, raw.data(), &size, NULL)) {
+			ensure(GetLastError() == ERROR_INSUFFICIENT_BUFFER || !__FUNCTION__ ": HttpQueryInfo failed");
+			raw.resize(size);
+			ensure(HttpQueryInfoA(h, HTTP_QUERY_RAW_HEADERS_CRLF, raw.data(), &size, NULL));
+		}
+		raw.resize(size);
+
+		return raw;
+	}
+
+	// InternetOpenUrl handle with response headers parsed on first use
+	class OpenUrl {
+		HInet h;
+		mutable std::optional<fms::http::headers> headers_;
+	public:
+		OpenUrl(HINTERNET h)
+			: h(h)
+		{ }
+		operator HINTERNET() const
+		{
+			return h;
+		}
+		const fms::http::headers& headers() const
+		{
+			if (!headers_) {
+				headers_.emplace(raw_headers(h));
+			}
+
+			return *headers_;
+		}
+	};
+
 } // namespace Inet
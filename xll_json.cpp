@@ -2,6 +2,7 @@
 #include <cassert>
 #endif
 #include "xll_json.h"
+#include "xll_view.h"
 
 //using namespace fms;
 using namespace xll;
@@ -112,6 +113,62 @@ Auto<OpenAfter> xaoa_json_type_test([]() {
 
 #endif // _DEBUG
 
+// parse the values of a rope one segment at a time
+inline OPER parse_rope(const rope_view<char>& r)
+{
+	std::vector<OPER> values;
+	OPER a; // top level array
+
+	auto push = [](OPER& x, const OPER& v) {
+		if (v.is_multi()) {
+			OPER xi(1, 1);
+			xi[0] = v;
+			x.push_right(xi);
+		}
+		else {
+			x.push_right(v);
+		}
+	};
+	auto f = [&](std::string_view v, size_t depth) {
+		if (depth == 0 and v == "[") {
+			a = OPER{};
+		}
+		else if (depth == 0 and v == "]") {
+			a.resize(1, a.size());
+			values.push_back(a);
+		}
+		else {
+			auto x = json::parse::view<XLOPERX, const char>(fms::char_view<const char>(v.data(), v.size()));
+			if (depth == 0) {
+				values.push_back(x);
+			}
+			else {
+				push(a, x);
+			}
+		}
+
+		return true;
+	};
+
+	json::scan::stream s;
+	r.each([&](std::string_view segment) { return s.feed(segment, f); });
+	s.finish(f);
+
+	if (values.size() == 1) {
+		return values[0];
+	}
+
+	OPER o;
+	for (const auto& v : values) {
+		push(o, v);
+	}
+	if (o.size()) {
+		o.resize(1, o.size());
+	}
+
+	return values.empty() ? OPER(ErrNA) : o;
+}
+
 AddIn xai_parse_json(
 	Function(XLL_LPOPER, "xll_parse_json", "JSON.PARSE")
 	.Arguments({
@@ -130,10 +187,14 @@ LPOPER WINAPI xll_parse_json(LPOPER pjson)
 	try {
 		o = ErrNA;
 		if (pjson->is_num()) {
-			handle<fms::char_view<char>> h_(pjson->val.num);
-			ensure(h_);
-			// convert from char to wchar if needed
-			o = json::parse::view<XLOPERX, char>(*h_);
+			if (auto r = rope<char>(pjson->val.num)) {
+				o = parse_rope(*r);
+			}
+			else {
+				auto h_ = resident<char>(pjson->val.num);
+				// convert from char to wchar if needed
+				o = json::parse::view<XLOPERX, char>(fms::char_view<char>(h_->buf, h_->len));
+			}
 		}
 		else {
 			ensure(pjson->is_str());
@@ -340,8 +401,26 @@ Auto<OpenAfter> xaoa_json_test([]() {
 	try {
 		//_crtBreakAlloc = 52474;
 		ensure(0 == xll::json::test());
-		//ensure(0 == xll::json::parse::test());
+		ensure(0 == xll::json::parse::test());
 		ensure(0 == xll::json::index_test<XLOPERX>());
+		ensure(0 == xll::json::scan::test());
+
+		{
+			// pages of a download as one rope
+			static char p1[] = "[1, \"a\", [2,";
+			static char p2[] = " 3]]";
+			shared_view<char> v1(std::make_shared<fms::view<char>>(p1, sizeof(p1) - 1));
+			shared_view<char> v2(std::make_shared<fms::view<char>>(p2, sizeof(p2) - 1));
+			handle<fms::view<char>> r_(new rope_view<char>);
+			auto r = rope<char>(r_.get());
+			r->append(v1, 0, v1.len);
+			r->append(v2, 0, v2.len);
+			OPER h(r_.get());
+			OPER o = *xll_parse_json(&h);
+			ensure(o.rows() == 1 and o.columns() == 3);
+			ensure(o[0] == 1 and o[1] == "a");
+			ensure(o[2][0].rows() == 1 and o[2][0].columns() == 2);
+		}
 	}
 	catch (const std::exception& ex) {
 		XLL_ERROR(ex.what());
@@ -2,9 +2,13 @@
 #pragma once
 #include <charconv>
 #include <iostream>
+#include <map>
 #include <sstream>
+#include <string_view>
+#include <vector>
 #include "xll/xll/xll.h"
 #include "xll_parse.h"
+#include "xll_utf8.h"
 
 static inline const char xll_parse_json_doc[] = R"xyzyx(
 The function <code>JSON.PARSE(string)</code> parses the JSON <code>string</code> into an <code>OPER</code>.
@@ -355,6 +359,13 @@ namespace xll::json {
 
 
 
+namespace xll::json::scan {
+
+	// forward declaration
+	inline std::string unescape(std::string_view s);
+
+} // namespace xll::json::scan
+
 namespace xll::json::parse {
 
 	// forward declaration
@@ -407,23 +418,52 @@ namespace xll::json::parse {
 		return XErrValue<X>;
 	}
 
+	// number at the start of v, dropping the characters used
 	template<class X, class T>
 	inline XOPER<X> number(fms::char_view<T>& v)
 	{
-		XOPER<X> o(v.buf, v.len);
-		xll::parse::convert(o, xltypeNum);
+		std::string s; // sign, digits, decimal point, and exponent
+		for (size_t i = 0; i < v.len and s.size() < 64; ++i) {
+			T c = v.buf[i];
+			if (!(('0' <= c and c <= '9') or c == '-' or c == '+' or c == '.' or c == 'e' or c == 'E')) {
+				break;
+			}
+			s.push_back(static_cast<char>(c));
+		}
 
-		return o;
+		double x;
+		auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), x);
+		if (ec != std::errc{} or ptr == s.data()) {
+			return XErrValue<X>;
+		}
+		v.drop(static_cast<size_t>(ptr - s.data()));
+
+		return XOPER<X>(x);
 	}
 
-	// "\"str\"" => "str"
+	// "\"str\"" => "str" with escapes replaced
 	template<class X, class T = typename traits<X>::xchar>
 	inline XOPER<X> string(fms::char_view<T>& v)
 	{
-		XOPER<X> o(v.buf, v.len);
-		o = Excel(xlfEvaluate, o);
+		v.wstrim();
+		ensure((v and v.front() == '"') || !__FUNCTION__ ": expected string");
+
+		size_t i = 1;
+		while (i < v.len and v.buf[i] != '"') {
+			i += v.buf[i] == '\\' ? 2 : 1;
+		}
+		ensure(i < v.len || !__FUNCTION__ ": unterminated string");
+
+		std::string u;
+		if constexpr (sizeof(T) == 1) {
+			u.assign(v.buf + 1, i - 1);
+		}
+		else {
+			u = to_utf8(XOPER<X>(v.buf + 1, static_cast<T>(i - 1)));
+		}
+		v.drop(i + 1);
 
-		return o;
+		return utf8(scan::unescape(u));
 	}
 
 	// object := "{ \"key\" : val , ... } "
@@ -434,6 +474,10 @@ namespace xll::json::parse {
 
 		v.wstrim().eat('{');
 		while (v.wstrim()) {
+			if (v.front() == '}') {
+				v.eat('}');
+				break;
+			}
 			auto key = string<X,T>(v);
 			v.wstrim();
 			v.eat(':');
@@ -526,7 +570,7 @@ namespace xll::json::parse {
 #define XLL_PARSE_JSON_VALUE(X) \
 	X("null", XErrNull<XLOPERX>) \
 	X("\"str\"", "str") \
-	X("\"s\\\"r\"", "s\\\"r") \
+	X("\"s\\\"r\"", "s\"r") \
 	X("\"s\nr\"", "s\nr") \
 	X("\"s r\"", "s r") \
 	X("[\"a\", 1.23, false]", json::array("a", 1.23, false)) \
@@ -569,6 +613,11 @@ namespace xll::json::parse {
 				fms::char_view num(_T("foo1.23"));
 				ensure(number<XLOPERX>(num) == ErrValue);
 			}
+			{
+				fms::char_view num("-2e3,4]");
+				ensure(number<XLOPERX>(num) == -2000);
+				ensure(num.equal(",4]"));
+			}
 		}
 		{
 			fms::char_view str("\"str\"");
@@ -576,7 +625,12 @@ namespace xll::json::parse {
 		}
 		{
 			fms::char_view str("\"s\\\"r\"");
-			ensure(parse::string<XLOPERX>(str) == "s\\\"r");
+			ensure(parse::string<XLOPERX>(str) == "s\"r");
+			ensure(!str);
+		}
+		{
+			fms::char_view str(_T("\"caf\\u00e9\\n\""));
+			ensure(parse::string<XLOPERX>(str) == OPER(_T("caf\u00E9\n")));
 			ensure(!str);
 		}
 		{
@@ -602,4 +656,388 @@ namespace xll::json::parse {
 #undef XLL_PARSE_JSON_VALUE
 #endif // _DEBUG
 
-} // namespace json::parse
\ No newline at end of file
+} // namespace json::parse
+
+// Find the extent of JSON values without converting them.
+namespace xll::json::scan {
+
+	inline std::string_view& ws(std::string_view& v)
+	{
+		while (v.size() and (v.front() == ' ' or v.front() == '\t' or v.front() == '\n' or v.front() == '\r')) {
+			v.remove_prefix(1);
+		}
+
+		return v;
+	}
+
+	// "str" => str with escapes left as is
+	inline std::string_view string(std::string_view& v)
+	{
+		ensure(ws(v).size() and v.front() == '"');
+
+		size_t i = 1;
+		while (i < v.size() and v[i] != '"') {
+			i += v[i] == '\\' ? 2 : 1;
+		}
+		ensure(i < v.size() || !__FUNCTION__ ": unterminated string");
+
+		auto s = v.substr(1, i - 1);
+		v.remove_prefix(i + 1);
+
+		return s;
+	}
+
+	// text of the next value
+	inline std::string_view value(std::string_view& v)
+	{
+		auto b = ws(v);
+		ensure(v.size() || !__FUNCTION__ ": expected value");
+
+		if (v.front() == '"') {
+			string(v);
+		}
+		else if (v.front() == '{' or v.front() == '[') {
+			size_t depth = 0;
+			do {
+				if (v.front() == '"') {
+					string(v);
+					continue;
+				}
+				if (v.front() == '{' or v.front() == '[') {
+					++depth;
+				}
+				else if (v.front() == '}' or v.front() == ']') {
+					--depth;
+				}
+				v.remove_prefix(1);
+			} while (depth and v.size());
+			ensure(depth == 0 || !__FUNCTION__ ": unbalanced brackets");
+		}
+		else {
+			// number, true, false, or null
+			while (v.size() and v.front() != ',' and v.front() != '}' and v.front() != ']'
+				and v.front() != ' ' and v.front() != '\t' and v.front() != '\n' and v.front() != '\r') {
+				v.remove_prefix(1);
+			}
+		}
+
+		return b.substr(0, b.size() - v.size());
+	}
+
+	// call f(key, value) for each member of an object
+	template<class F>
+	inline void members(std::string_view v, F f)
+	{
+		ensure(ws(v).size() and v.front() == '{');
+		v.remove_prefix(1);
+
+		while (ws(v).size() and v.front() != '}') {
+			auto key = string(v);
+			ensure(ws(v).size() and v.front() == ':');
+			v.remove_prefix(1);
+			f(key, value(v));
+			if (ws(v).size() and v.front() == ',') {
+				v.remove_prefix(1);
+			}
+		}
+	}
+
+	// call f(value) for each element of an array
+	template<class F>
+	inline void elements(std::string_view v, F f)
+	{
+		ensure(ws(v).size() and v.front() == '[');
+		v.remove_prefix(1);
+
+		while (ws(v).size() and v.front() != ']') {
+			f(value(v));
+			if (ws(v).size() and v.front() == ',') {
+				v.remove_prefix(1);
+			}
+		}
+	}
+
+	// value of top level key or empty if not found
+	inline std::string_view member(std::string_view v, std::string_view key)
+	{
+		std::string_view m;
+
+		members(v, [&m, key](std::string_view k, std::string_view val) {
+			if (m.empty() and k == key) {
+				m = val;
+			}
+		});
+
+		return m;
+	}
+
+	// contents of a JSON string with escapes replaced and \\uXXXX encoded as UTF-8
+	inline std::string unescape(std::string_view s)
+	{
+		std::string u;
+		u.reserve(s.size());
+
+		auto hex4 = [&s](size_t i) {
+			ensure(i + 4 <= s.size() || !__FUNCTION__ ": short \\u escape");
+			unsigned x = 0;
+			for (size_t j = i; j < i + 4; ++j) {
+				char c = s[j];
+				x = 16 * x + (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+			}
+			return x;
+		};
+
+		for (size_t i = 0; i < s.size(); ++i) {
+			if (s[i] != '\\' or i + 1 == s.size()) {
+				u.push_back(s[i]);
+				continue;
+			}
+			switch (char c = s[++i]) {
+			case 'b': u.push_back('\b'); break;
+			case 'f': u.push_back('\f'); break;
+			case 'n': u.push_back('\n'); break;
+			case 'r': u.push_back('\r'); break;
+			case 't': u.push_back('\t'); break;
+			case 'u': {
+				unsigned x = hex4(i + 1);
+				i += 4;
+				if (0xD800 <= x and x < 0xDC00 and i + 6 < s.size() and s[i + 1] == '\\' and s[i + 2] == 'u') {
+					x = 0x10000 + ((x - 0xD800) << 10) + (hex4(i + 3) - 0xDC00);
+					i += 6;
+				}
+				if (x < 0x80) {
+					u.push_back(static_cast<char>(x));
+				}
+				else if (x < 0x800) {
+					u.push_back(static_cast<char>(0xC0 | (x >> 6)));
+					u.push_back(static_cast<char>(0x80 | (x & 0x3F)));
+				}
+				else if (x < 0x10000) {
+					u.push_back(static_cast<char>(0xE0 | (x >> 12)));
+					u.push_back(static_cast<char>(0x80 | ((x >> 6) & 0x3F)));
+					u.push_back(static_cast<char>(0x80 | (x & 0x3F)));
+				}
+				else {
+					u.push_back(static_cast<char>(0xF0 | (x >> 18)));
+					u.push_back(static_cast<char>(0x80 | ((x >> 12) & 0x3F)));
+					u.push_back(static_cast<char>(0x80 | ((x >> 6) & 0x3F)));
+					u.push_back(static_cast<char>(0x80 | (x & 0x3F)));
+				}
+				break;
+			}
+			default: // '"', '\\', '/'
+				u.push_back(c);
+			}
+		}
+
+		return u;
+	}
+
+	// scalar value as an OPER, objects and arrays as their JSON text
+	inline OPER oper(std::string_view v)
+	{
+		if (ws(v).empty()) {
+			return ErrNA;
+		}
+
+		switch (v.front()) {
+		case '"': {
+			return utf8(unescape(string(v)));
+		}
+		case '{':
+		case '[':
+			return utf8(v);
+		case 't':
+			return OPER(true);
+		case 'f':
+			return OPER(false);
+		case 'n':
+			return ErrNull;
+		}
+
+		double x;
+		auto [ptr, ec] = std::from_chars(v.data(), v.data() + v.size(), x);
+
+		return ec == std::errc{} ? OPER(x) : OPER(ErrValue);
+	}
+
+	// Top level values of JSON text arriving in chunks. Top level arrays are split
+	// into their elements so only values that cross a chunk boundary are copied.
+	class stream {
+		enum class kind { none, scalar, string, bracket };
+
+		std::string carry; // partial value
+		kind value = kind::none; // being collected
+		size_t depth = 0; // of brackets
+		bool array = false; // inside a top level array
+		bool quoted = false;
+		bool escaped = false;
+		bool done = false;
+
+		// depth values are collected at
+		size_t level() const
+		{
+			return array ? 1 : 0;
+		}
+	public:
+		// false after a callback returned false
+		bool is_done() const
+		{
+			return done;
+		}
+
+		// Call f(value, depth) for each complete value in chunk until f returns false.
+		// The elements of a top level array have depth 1 and are preceded by "[" and
+		// followed by "]" with depth 0.
+		template<class F>
+		bool feed(std::string_view chunk, F&& f)
+		{
+			size_t b = 0; // start of value in chunk
+			auto emit = [&](size_t e) {
+				if (carry.size()) {
+					carry.append(chunk.substr(b, e - b));
+					done = !f(std::string_view(carry), level());
+					carry.clear();
+				}
+				else {
+					done = !f(chunk.substr(b, e - b), level());
+				}
+				value = kind::none;
+			};
+			auto start = [&](size_t i, kind k) {
+				b = i;
+				value = k;
+			};
+
+			for (size_t i = 0; i < chunk.size() and !done; ++i) {
+				char c = chunk[i];
+				if (quoted) {
+					if (escaped) {
+						escaped = false;
+					}
+					else if (c == '\\') {
+						escaped = true;
+					}
+					else if (c == '"') {
+						quoted = false;
+						if (value == kind::string) {
+							emit(i + 1);
+						}
+					}
+					continue;
+				}
+
+				bool end = c == ' ' or c == '\t' or c == '\n' or c == '\r' or c == ',' or c == ']' or c == '}';
+				if (value == kind::scalar and end) {
+					emit(i);
+					if (done) {
+						break;
+					}
+				}
+
+				if (c == '"') {
+					quoted = true;
+					if (value == kind::none and depth == level()) {
+						start(i, kind::string);
+					}
+				}
+				else if (c == '[' or c == '{') {
+					if (depth == 0 and c == '[') {
+						array = true;
+						done = !f(std::string_view("["), 0);
+					}
+					else if (value == kind::none and depth == level()) {
+						start(i, kind::bracket);
+					}
+					++depth;
+				}
+				else if (c == ']' or c == '}') {
+					ensure(depth || !__FUNCTION__ ": unbalanced brackets");
+					--depth;
+					if (array and depth == 0) {
+						array = false;
+						done = !f(std::string_view("]"), 0);
+					}
+					else if (value == kind::bracket and depth == level()) {
+						emit(i + 1);
+					}
+				}
+				else if (!end and value == kind::none and depth == level()) {
+					start(i, kind::scalar);
+				}
+			}
+			if (!done and value != kind::none) {
+				carry.append(chunk.substr(b));
+			}
+
+			return !done;
+		}
+
+		// call f on a scalar value at the end of the text
+		template<class F>
+		void finish(F&& f)
+		{
+			if (!done) {
+				ensure((depth == 0 and value != kind::string and value != kind::bracket) || !__FUNCTION__ ": incomplete JSON value");
+				if (value == kind::scalar) {
+					f(std::string_view(carry), level());
+				}
+			}
+			carry.clear();
+			value = kind::none;
+			done = true;
+		}
+	};
+
+#ifdef _DEBUG
+
+	inline int test()
+	{
+		std::string_view wd = "{\"entities\":"
+			"{\"Q64\":{\"id\":\"Q64\",\"en\":\"a \\\"}\\\" b\"},"
+			" \"Q1\" : {\"x\":[1,2,{\"y\":null}]}"
+			"},\"success\":1}";
+		ensure(member(wd, "success") == "1");
+		ensure(member(wd, "missing").empty());
+
+		std::map<std::string_view, std::string_view> es;
+		members(member(wd, "entities"), [&es](std::string_view k, std::string_view v) { es[k] = v; });
+		ensure(es.size() == 2);
+		ensure(es["Q64"] == "{\"id\":\"Q64\",\"en\":\"a \\\"}\\\" b\"}");
+		ensure(es["Q1"] == "{\"x\":[1,2,{\"y\":null}]}");
+
+		std::vector<std::string_view> xs;
+		elements(member(es["Q1"], "x"), [&xs](std::string_view x) { xs.push_back(x); });
+		ensure(xs.size() == 3);
+		ensure(xs[0] == "1");
+		ensure(xs[2] == "{\"y\":null}");
+
+		ensure(unescape("a\\\"b\\n") == "a\"b\n");
+		ensure(unescape("\\u00e9\\u20AC") == "\xC3\xA9\xE2\x82\xAC");
+		ensure(unescape("\\ud83d\\ude00") == "\xF0\x9F\x98\x80");
+
+		// values split every n characters
+		std::string_view text = " [1, \"a,]\\\"\", {\"b\":[2]}, [], true] {\"c\":3} -4.5e1 ";
+		for (size_t n = 1; n <= text.size(); ++n) {
+			std::vector<std::string> vs;
+			stream s;
+			auto f = [&vs](std::string_view v, size_t depth) {
+				vs.push_back(std::to_string(depth) + std::string(v));
+				return true;
+			};
+			for (size_t i = 0; i < text.size(); i += n) {
+				s.feed(text.substr(i, n), f);
+			}
+			s.finish(f);
+			ensure(vs.size() == 9);
+			ensure(vs[0] == "0[" and vs[1] == "11" and vs[2] == "1\"a,]\\\"\"");
+			ensure(vs[3] == "1{\"b\":[2]}" and vs[4] == "1[]" and vs[5] == "1true" and vs[6] == "0]");
+			ensure(vs[7] == "0{\"c\":3}" and vs[8] == "0-4.5e1");
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+
+} // namespace xll::json::scan
@@ -1,6 +1,11 @@
 // xll_parse.h - string parsing
 #pragma once
+#include <charconv>
+#include <climits>
+#include <string_view>
+#include <type_traits>
 #include "xll/xll/xll.h"
+#include "fms_date.h"
 #include "fms_parse/fms_parse.h"
 
 // phony xltypes
@@ -23,26 +28,184 @@
 
 namespace xll::parse {
 
+	inline std::string_view trim(std::string_view s)
+	{
+		while (s.size() and (s.front() == ' ' or s.front() == '\t')) {
+			s.remove_prefix(1);
+		}
+		while (s.size() and (s.back() == ' ' or s.back() == '\t' or s.back() == '\r')) {
+			s.remove_suffix(1);
+		}
+
+		return s;
+	}
+
+	// Decimal number with optional sign, exponent, and trailing percent.
+	// The decimal point is always '.' independent of the locale.
+	inline bool number(std::string_view s, double& x)
+	{
+		s = trim(s);
+		bool percent = s.size() and s.back() == '%';
+		if (percent) {
+			s.remove_suffix(1);
+		}
+		if (s.size() and s.front() == '+') {
+			s.remove_prefix(1);
+			if (s.size() and s.front() == '-') {
+				return false;
+			}
+		}
+		// from_chars accepts inf and nan
+		auto c = s.size() and s.front() == '-' ? s.substr(1, 1) : s.substr(0, 1);
+		if (c.empty() or !(('0' <= c[0] and c[0] <= '9') or c[0] == '.')) {
+			return false;
+		}
+		auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), x);
+		if (ec != std::errc{} or ptr != s.data() + s.size()) {
+			return false;
+		}
+		if (percent) {
+			x /= 100;
+		}
+
+		return true;
+	}
+
+	// Fractions are truncated toward zero, unlike INT which rounds down.
+	inline bool integer(std::string_view s, long long& i)
+	{
+		s = trim(s);
+		if (s.size() and s.front() == '+') {
+			s.remove_prefix(1);
+			if (s.size() and s.front() == '-') {
+				return false;
+			}
+		}
+		auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), i);
+		if (ec == std::errc{} and ptr == s.data() + s.size()) {
+			return true;
+		}
+		double x;
+		if (!number(s, x) or !(-9.2e18 < x and x < 9.2e18)) {
+			return false;
+		}
+		i = static_cast<long long>(x);
+
+		return true;
+	}
+
+	// TRUE or FALSE in any case, or a number that is true if not zero
+	inline bool boolean(std::string_view s, bool& b)
+	{
+		s = trim(s);
+		auto is = [s](std::string_view t) {
+			if (s.size() != t.size()) {
+				return false;
+			}
+			for (size_t i = 0; i < s.size(); ++i) {
+				if ((s[i] & ~0x20) != t[i]) {
+					return false;
+				}
+			}
+			return true;
+		};
+		if (is("TRUE")) {
+			b = true;
+
+			return true;
+		}
+		if (is("FALSE")) {
+			b = false;
+
+			return true;
+		}
+		double x;
+		if (number(s, x)) {
+			b = x != 0;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	// Characters of a string as ASCII in buf. Return empty if o is not
+	// a string or has characters that are not ASCII or does not fit.
+	template<class X, size_t N>
+	inline std::string_view ascii(const XOPER<X>& o, char (&buf)[N])
+	{
+		if (!o.is_str()) {
+			return std::string_view{};
+		}
+		using count = std::make_unsigned_t<std::remove_cvref_t<decltype(o.val.str[0])>>;
+		size_t n = static_cast<count>(o.val.str[0]);
+		if (n > N) {
+			return std::string_view{};
+		}
+		for (size_t i = 0; i < n; ++i) {
+			auto c = o.val.str[i + 1];
+			if (c <= 0 or c >= 0x80) {
+				return std::string_view{};
+			}
+			buf[i] = static_cast<char>(c);
+		}
+
+		return std::string_view(buf, n);
+	}
+
 	template<class X>
 	inline void convert(XOPER<X>& o, int type)
 	{
 		if (type == xltypeNum || type == xltypeBool || type == xltypeInt) {
-			o = Excel(xlfEvaluate, o);
-			if (type == xltypeBool and !o.is_bool()) {
-				o = !!o;
-				ensure(o.is_bool());
+			char buf[64];
+			auto s = ascii(o, buf);
+			double x;
+			long long i;
+			bool b;
+			if (type == xltypeNum and number(s, x)) {
+				o = x;
 			}
-			else if (type == xltypeInt) {
-				o.val.w = static_cast<traits<X>::xint>(o.val.num);
+			else if (type == xltypeInt and integer(s, i)) {
+				o = static_cast<double>(i);
+				o.val.w = static_cast<traits<X>::xint>(i);
 				o.xltype = xltypeInt;
 			}
+			else if (type == xltypeBool and boolean(s, b)) {
+				o = b;
+			}
+			else {
+				// formulas and anything else Excel can evaluate
+				o = Excel(xlfEvaluate, o);
+				if (type == xltypeBool and !o.is_bool()) {
+					o = !!o;
+					ensure(o.is_bool());
+				}
+				else if (type == xltypeInt) {
+					o.val.w = static_cast<traits<X>::xint>(o.val.num);
+					o.xltype = xltypeInt;
+				}
+			}
 		}
 		else if (type == xltypeDate) {
-			o = Excel(xlfDatevalue, o);
+			char buf[64];
+			double x;
+			if (fms::date::parse(trim(ascii(o, buf)), x)) {
+				o = x;
+			}
+			else {
+				o = Excel(xlfDatevalue, o);
+			}
 			o.xltype = xltypeDate;
 		}
 		else if (type == xltypeTime) {
-			o = Excel(xlfTimevalue, o);
+			char buf[64];
+			double x;
+			if (fms::date::time(trim(ascii(o, buf)), x)) {
+				o = x;
+			}
+			else {
+				o = Excel(xlfTimevalue, o);
+			}
 			o.xltype = xltypeTime;
 		}
 	}
@@ -54,4 +217,44 @@ namespace xll::parse {
 		}
 	}
 
+#ifdef _DEBUG
+
+	inline int test()
+	{
+		double x;
+		ensure(number("1.5", x) and x == 1.5);
+		ensure(number(" -2e3\r", x) and x == -2000);
+		ensure(number("+.25", x) and x == .25);
+		ensure(number("50%", x) and x == .5);
+		ensure(number("0.1", x) and x == 0.1);
+		ensure(!number("", x));
+		ensure(!number("1,5", x));
+		ensure(!number("1.5x", x));
+		ensure(!number("inf", x));
+		ensure(!number("-nan", x));
+		ensure(!number("+-1", x));
+		ensure(!number("2021-01-02", x));
+
+		long long i;
+		ensure(integer("123", i) and i == 123);
+		ensure(integer("-9223372036854775808", i) and i == LLONG_MIN);
+		ensure(integer("+7", i) and i == 7);
+		ensure(integer("-2.9", i) and i == -2);
+		ensure(!integer("+-5", i));
+		ensure(!integer("+-2.5", i));
+		ensure(!integer("1e30", i));
+		ensure(!integer("x", i));
+
+		bool b;
+		ensure(boolean("TRUE", b) and b);
+		ensure(boolean("false", b) and !b);
+		ensure(boolean("0", b) and !b);
+		ensure(boolean("-1.5", b) and b);
+		ensure(!boolean("yes", b));
+
+		return 0;
+	}
+
+#endif // _DEBUG
+
 } // xll
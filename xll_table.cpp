@@ -0,0 +1,697 @@
+// xll_table.cpp - tables from URLs and views
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <optional>
+#include "fms_csv.h"
+#include "xll_cache.h"
+#include "xll_inet.h"
+#include "xll_json.h"
+#include "xll_table.h"
+#include "xll_view.h"
+
+using namespace xll;
+
+// rows and columns to keep from a table
+class projection {
+	std::vector<unsigned> rows; // in requested order, empty for all
+	std::vector<OPER> columns; // indices or names, empty for all
+	std::map<unsigned, unsigned> keep_; // row to number of times requested
+public:
+	std::vector<unsigned> index; // resolved column indices
+
+	projection(const OPER& cols, const OPER& rows_)
+	{
+		if (!rows_.is_missing() and !rows_.is_nil()) {
+			for (const auto& r : rows_) {
+				ensure((r.is_num() and r.as_num() >= 0) || !__FUNCTION__ ": rows must be non-negative indices");
+				rows.push_back(static_cast<unsigned>(r.as_num()));
+				++keep_[rows.back()];
+			}
+		}
+		if (!cols.is_missing() and !cols.is_nil()) {
+			for (const auto& c : cols) {
+				ensure((c.is_str() or (c.is_num() and c.as_num() >= 0)) || !__FUNCTION__ ": columns must be names or non-negative indices");
+				columns.push_back(c);
+			}
+		}
+	}
+
+	bool keep(unsigned r) const
+	{
+		return rows.empty() or keep_.contains(r);
+	}
+	// stop reading after this row
+	unsigned last() const
+	{
+		return rows.empty() ? UINT_MAX : keep_.rbegin()->first;
+	}
+	// resolve column names given the names of all columns
+	void resolve(const std::vector<OPER>& names)
+	{
+		index.clear();
+		if (columns.empty()) {
+			for (unsigned j = 0; j < names.size(); ++j) {
+				index.push_back(j);
+			}
+		}
+		for (const auto& c : columns) {
+			if (c.is_num()) {
+				index.push_back(static_cast<unsigned>(c.as_num()));
+			}
+			else {
+				auto j = std::find(names.begin(), names.end(), c);
+				index.push_back(j == names.end() ? UINT_MAX : static_cast<unsigned>(j - names.begin()));
+			}
+		}
+	}
+
+	// keys of the columns to return given the keys of the first object
+	std::vector<std::optional<std::string>> keys(const std::vector<std::string>& first) const
+	{
+		std::vector<std::optional<std::string>> k;
+		if (columns.empty()) {
+			k.assign(first.begin(), first.end());
+		}
+		for (const auto& c : columns) {
+			if (c.is_num()) {
+				auto j = static_cast<size_t>(c.as_num());
+				k.push_back(j < first.size() ? std::optional<std::string>(first[j]) : std::nullopt);
+			}
+			else {
+				k.push_back(to_utf8(c));
+			}
+		}
+
+		return k;
+	}
+
+	// rows of cells with given row ids in requested order
+	OPER table(const std::vector<unsigned>& ids, const std::vector<OPER>& cells) const
+	{
+		auto c = static_cast<unsigned>(index.size());
+		if (c == 0 or cells.empty()) {
+			return ErrNA;
+		}
+
+		auto n = rows.empty() ? static_cast<unsigned>(ids.size()) : static_cast<unsigned>(rows.size());
+		OPER o(n, c);
+		if (rows.empty()) {
+			for (unsigned i = 0; i < n; ++i) {
+				for (unsigned j = 0; j < c; ++j) {
+					o(i, j) = cells[i * c + j];
+				}
+			}
+		}
+		else {
+			std::map<unsigned, unsigned> at; // row id to position in ids
+			for (unsigned i = 0; i < ids.size(); ++i) {
+				at[ids[i]] = i;
+			}
+			for (unsigned i = 0; i < n; ++i) {
+				auto k = at.find(rows[i]);
+				for (unsigned j = 0; j < c; ++j) {
+					o(i, j) = k == at.end() ? OPER(ErrNA) : cells[k->second * c + j];
+				}
+			}
+		}
+
+		return o;
+	}
+};
+
+#ifdef _DEBUG
+
+Auto<OpenAfter> xaoa_csv_stream_test([]() {
+	try {
+		std::string_view data("a,b,c\r\n1,\"x,\"\"y\",3\n4,\"multi\nline\",6\n7,8,9");
+		for (size_t n = 1; n <= data.size(); ++n) {
+			fms::csv::stream s;
+			std::vector<std::string> records;
+			auto f = [&records](std::string_view r) { records.emplace_back(r); return true; };
+			for (size_t i = 0; i < data.size(); i += n) {
+				s.feed(data.substr(i, n), f);
+			}
+			s.finish(f);
+			ensure(records.size() == 4);
+			ensure(records[0] == "a,b,c");
+			ensure(records[1] == "1,\"x,\"\"y\",3");
+			ensure(records[2] == "4,\"multi\nline\",6");
+			ensure(records[3] == "7,8,9");
+		}
+		{
+			fms::csv::dialect d;
+			std::vector<std::string_view> fields;
+			std::string tmp;
+			fms::csv::split("1,\"x,\"\"y\",3", d, fields);
+			ensure(fields.size() == 3);
+			ensure(fms::csv::unquote(fields[1], d, tmp) == "x,\"y");
+			fms::csv::split("a\\,b,c", d, fields);
+			ensure(fields.size() == 2);
+			ensure(fms::csv::unquote(fields[0], d, tmp) == "a,b");
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return FALSE;
+	}
+
+	return TRUE;
+});
+
+#endif // _DEBUG
+
+// stream records into the projection without keeping the body
+inline OPER csv_table(LPCTSTR url, char fs, projection& p)
+{
+	fms::csv::dialect d;
+	d.fs = fs;
+	fms::csv::stream s(d);
+
+	std::vector<unsigned> ids;
+	std::vector<OPER> cells;
+	std::vector<std::string_view> fields;
+	std::string tmp;
+	unsigned r = 0;
+	auto last = p.last();
+
+	auto record = [&](std::string_view rec) {
+		if (r == 0) {
+			std::vector<OPER> names;
+			for (auto field : fms::csv::split(rec, d, fields)) {
+				auto name = fms::csv::unquote(field, d, tmp);
+				names.push_back(utf8(name));
+			}
+			p.resolve(names);
+		}
+		if (p.keep(r)) {
+			fms::csv::split(rec, d, fields);
+			for (auto j : p.index) {
+				if (j < fields.size()) {
+					auto field = fms::csv::unquote(fields[j], d, tmp);
+					cells.push_back(utf8(field));
+				}
+				else {
+					cells.push_back(ErrNA);
+				}
+			}
+			ids.push_back(r);
+		}
+
+		return r++ < last;
+	};
+
+	Inet::read_url(url, USER_AGENT_HEADER, static_cast<DWORD>(-1L), 0, [&](const char* buf, DWORD len) {
+		return s.feed(std::string_view(buf, len), record);
+	});
+	s.finish(record);
+
+	return p.table(ids, cells);
+}
+
+// array of objects or arrays with only the projected values converted
+inline OPER json_table(LPCTSTR url, projection& p)
+{
+	std::string body;
+	Inet::read_url(url, USER_AGENT_HEADER, static_cast<DWORD>(-1L), 0, [&body](const char* buf, DWORD len) {
+		body.append(buf, len);
+
+		return true;
+	});
+
+	std::vector<unsigned> ids;
+	std::vector<OPER> cells;
+	std::vector<std::string_view> values;
+	std::vector<std::optional<std::string>> keys; // of the columns if rows are objects
+	std::map<std::string, std::string_view> members;
+	unsigned r = 0;
+
+	json::scan::elements(body, [&](std::string_view e) {
+		if (p.keep(r)) {
+			bool object = json::scan::ws(e).size() and e.front() == '{';
+			values.clear();
+			members.clear();
+			if (object) {
+				json::scan::members(e, [&members](std::string_view k, std::string_view v) {
+					members.emplace(json::scan::unescape(k), v);
+				});
+			}
+			else {
+				json::scan::elements(e, [&values](std::string_view v) { values.push_back(v); });
+			}
+
+			if (ids.empty()) {
+				// names are the keys in the order of the first object
+				std::vector<std::string> first;
+				if (object) {
+					json::scan::members(e, [&first](std::string_view k, std::string_view) {
+						first.push_back(json::scan::unescape(k));
+					});
+				}
+				std::vector<OPER> names;
+				for (unsigned j = 0; j < (object ? first.size() : values.size()); ++j) {
+					names.push_back(object ? utf8(first[j]) : OPER(j));
+				}
+				p.resolve(names);
+				if (object) {
+					keys = p.keys(first);
+				}
+			}
+
+			for (unsigned k = 0; k < p.index.size(); ++k) {
+				if (object) {
+					// objects are matched by key since their keys can be in any order
+					auto m = k < keys.size() and keys[k] ? members.find(*keys[k]) : members.end();
+					cells.push_back(m != members.end() ? json::scan::oper(m->second) : OPER(ErrNA));
+				}
+				else {
+					auto j = p.index[k];
+					cells.push_back(j < values.size() ? json::scan::oper(values[j]) : OPER(ErrNA));
+				}
+			}
+			ids.push_back(r);
+		}
+		++r;
+	});
+
+	return p.table(ids, cells);
+}
+
+AddIn xai_url_table(
+	Function(XLL_LPOPER, "xll_url_table", "URL.TABLE")
+	.Arguments({
+		Arg(XLL_CSTRING, "url", "is a URL to read."),
+		Arg(XLL_CSTRING4, "_format", "is an optional format of \"csv\", \"tsv\", or \"json\". Default is \"csv\"."),
+		Arg(XLL_LPOPER, "_columns", "are optional 0-based column indices or names to return. Default is all."),
+		Arg(XLL_LPOPER, "_rows", "are optional 0-based row indices to return. Default is all."),
+		})
+	.Category(CATEGORY)
+	.FunctionHelp("Return rows and columns of the table at url.")
+	.Documentation(R"xyzyx(
+This is equivalent to <code>RANGE.INDEX(CSV.PARSE(\URL.VIEW(url)), rows, columns)</code>
+without creating a view or parsing the fields that are not returned.
+CSV data is parsed as it is read and reading stops after the last row requested.
+Column names are matched against the first row.
+All values are returned as strings.
+<p>
+JSON data must be an array of objects or arrays. Rows are the elements of the array and columns are
+object keys or array indices. Column indices of objects refer to the keys of the first object
+and every object is matched by key so keys can be in any order or missing. Only the values returned are converted.
+Nested objects and arrays are returned as JSON strings.
+</p>
+)xyzyx")
+);
+LPOPER WINAPI xll_url_table(LPCTSTR url, const char* format, LPOPER pcolumns, LPOPER prows)
+{
+#pragma XLLEXPORT
+	static OPER o;
+
+	try {
+		projection p(*pcolumns, *prows);
+
+		std::string_view fmt(format);
+		if (fmt.empty() or fmt == "csv") {
+			o = csv_table(url, ',', p);
+		}
+		else if (fmt == "tsv") {
+			o = csv_table(url, '\t', p);
+		}
+		else if (fmt == "json") {
+			o = json_table(url, p);
+		}
+		else {
+			ensure(!__FUNCTION__ ": format must be \"csv\", \"tsv\", or \"json\"");
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		o = ErrNA;
+	}
+
+	return &o;
+}
+
+AddIn xai_csv_table(
+	Function(XLL_HANDLEX, "xll_csv_table", "\\CSV.TABLE")
+	.Arguments({
+		Arg(XLL_HANDLEX, "view", "is a handle to a view of comma separated values."),
+		Arg(XLL_LPOPER, "_header", "is an optional boolean indicating the first row has column names. Default is TRUE or sniffed if _fs is \"auto\"."),
+		Arg(XLL_CSTRING4, "_rs", "is an optional record separator. Default is newline '\\n'."),
+		Arg(XLL_CSTRING4, "_fs", "is an optional field separator or \"auto\" to sniff the dialect. Default is comma ','."),
+		Arg(XLL_CSTRING4, "_esc", "is an optional escape character. Default is backslash '\\'."),
+		Arg(XLL_CSTRING4, "_cache", "is an optional path of a binary cache file for the table."),
+		})
+	.Uncalced()
+	.Category("CSV")
+	.FunctionHelp("Return a handle to a table of typed columns parsed from view.")
+	.Documentation(R"xyzyx(
+Each column is stored as a contiguous array of one type: integer, number, date, or string.
+Strings are stored once per distinct value. The type of a column is the narrowest type
+holding all of its nonempty fields. Empty fields in number and date columns are <code>#N/A</code>.
+Use <code>TABLE.COLUMN</code> and <code>TABLE.ROWS</code> to get values from the table.
+<p>
+If <code>_cache</code> has a file made from the same bytes of <code>view</code> parsed the same way
+it is mapped into memory and nothing is parsed. Otherwise the table is parsed and saved to a new file.
+Files are named by appending a hash of the source to <code>_cache</code> so a file that is
+still mapped is never replaced. Later writes delete older files once nothing maps them.
+The file has a header followed by a 64-byte aligned block for each column so
+<code>TABLE.ARRAY</code> returns number and date columns of a cached table without copying.
+Cached tables are read only and can not be refreshed.
+</p>
+)xyzyx")
+);
+HANDLEX WINAPI xll_csv_table(HANDLEX view, LPOPER pheader, const char* _rs, const char* _fs, const char* _e, const char* _cache)
+{
+#pragma XLLEXPORT
+	HANDLEX h = INVALID_HANDLEX;
+
+	try {
+		auto d = csv_dialect(view, _rs, _fs, _e);
+		bool header = true;
+		if (!pheader->is_missing() and !pheader->is_nil()) {
+			header = !!*pheader;
+		}
+		else if (std::string_view(_fs) == "auto") {
+			header = sniff(view).header;
+		}
+
+		auto u = text(*resident<char>(view));
+		std::string_view s(u.buf, u.len);
+		uint64_t key = 0;
+		if (*_cache) {
+			key = cache::key(s, cache::how("table", d, OPER(header ? 1. : 0.)));
+			if (auto m = cache::open(_cache, key)) {
+				handle<table> h_(new cache::cached(std::move(m)));
+				ensure(h_);
+
+				return h_.get();
+			}
+		}
+
+		auto t = new columnar(s, d, header);
+		handle<table> h_(t);
+		ensure(h_);
+		h = h_.get();
+		if (*_cache and !cache::write(_cache, key, cache::file(*t, key))) {
+			XLL_WARNING(__FUNCTION__ ": could not write cache file");
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+
+	return h;
+}
+
+AddIn xai_table_refresh(
+	Function(XLL_HANDLEX, "xll_table_refresh", "TABLE.REFRESH")
+	.Arguments({
+		Arg(XLL_HANDLEX, "table", "is a handle returned by \\CSV.TABLE."),
+		Arg(XLL_HANDLEX, "view", "is a handle to a view of the current source data."),
+		})
+	.Category("CSV")
+	.FunctionHelp("Update table from view and return the table handle.")
+	.Documentation(R"xyzyx(
+A table remembers the offset and a hash of the bytes up to its last complete record.
+If <code>view</code> starts with the same bytes only the bytes after them are parsed
+and the new rows are appended to the table. Otherwise the whole view is parsed again.
+Use this to poll append-only sources such as logs without parsing the whole body each time.
+)xyzyx")
+);
+HANDLEX WINAPI xll_table_refresh(HANDLEX h, HANDLEX view)
+{
+#pragma XLLEXPORT
+	try {
+		handle<table> t_(h);
+		ensure(t_);
+		auto t = dynamic_cast<columnar*>(t_.ptr());
+		ensure(t || !__FUNCTION__ ": cached tables can not be refreshed");
+
+		auto u = text(*resident<char>(view));
+		t->refresh(std::string_view(u.buf, u.len));
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		h = INVALID_HANDLEX;
+	}
+
+	return h;
+}
+
+AddIn xai_table_columns(
+	Function(XLL_LPOPER, "xll_table_columns", "TABLE.COLUMNS")
+	.Arguments({
+		Arg(XLL_HANDLEX, "table", "is a handle returned by \\CSV.TABLE."),
+		})
+	.Category("CSV")
+	.FunctionHelp("Return a two row range of the column names and types of table.")
+	.Documentation(R"xyzyx(
+The first row has the column names and the second row has their types.
+Columns without a name are named by their 0-based index.
+)xyzyx")
+);
+LPOPER WINAPI xll_table_columns(HANDLEX h)
+{
+#pragma XLLEXPORT
+	static OPER o;
+
+	try {
+		handle<table> t_(h);
+		ensure(t_);
+		const auto& t = *t_;
+
+		o = OPER(2, static_cast<unsigned>(t.size()));
+		for (unsigned j = 0; j < t.size(); ++j) {
+			o(0, j) = t.heading(j);
+			o(1, j) = table::name(t.kind(j));
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		o = ErrNA;
+	}
+
+	return &o;
+}
+
+AddIn xai_table_column(
+	Function(XLL_LPOPER, "xll_table_column", "TABLE.COLUMN")
+	.Arguments({
+		Arg(XLL_HANDLEX, "table", "is a handle returned by \\CSV.TABLE."),
+		Arg(XLL_LPOPER, "column", "is a column name or 0-based index."),
+		})
+	.Category("CSV")
+	.FunctionHelp("Return one column of table.")
+	.Documentation(R"xyzyx(
+Only the values of the column are converted.
+)xyzyx")
+);
+LPOPER WINAPI xll_table_column(HANDLEX h, LPOPER pcolumn)
+{
+#pragma XLLEXPORT
+	static OPER o;
+
+	try {
+		handle<table> t_(h);
+		ensure(t_);
+		const auto& t = *t_;
+		auto j = t.find(*pcolumn);
+		ensure(j < t.size() || !__FUNCTION__ ": column not found");
+
+		o = OPER(static_cast<unsigned>(t.rows()), 1);
+		for (unsigned i = 0; i < t.rows(); ++i) {
+			o[i] = t.cell(i, j);
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		o = ErrNA;
+	}
+
+	return &o;
+}
+
+AddIn xai_table_array(
+	Function(XLL_FPX, "xll_table_array", "TABLE.ARRAY")
+	.Arguments({
+		Arg(XLL_HANDLEX, "table", "is a handle returned by \\CSV.TABLE."),
+		Arg(XLL_LPOPER, "column", "is a column name or 0-based index."),
+		})
+	.Category("CSV")
+	.FunctionHelp("Return an integer, number, or date column of table as an array of numbers.")
+	.Documentation(R"xyzyx(
+Missing values are NaN.
+)xyzyx")
+);
+_FPX* WINAPI xll_table_array(HANDLEX h, LPOPER pcolumn)
+{
+#pragma XLLEXPORT
+	static FPX a;
+
+	try {
+		handle<table> t_(h);
+		ensure(t_);
+		const auto& t = *t_;
+		auto j = t.find(*pcolumn);
+		ensure(j < t.size() || !__FUNCTION__ ": column not found");
+
+		ensure(t.kind(j) != table::type::string || !__FUNCTION__ ": column must not be a string");
+		if (auto p = t.array(j)) {
+			return const_cast<_FPX*>(p); // Excel copies the result before the table can change
+		}
+		a.resize(static_cast<unsigned>(t.rows()), 1);
+		for (unsigned i = 0; i < t.rows(); ++i) {
+			a[i] = t.number(i, j);
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		a.resize(0, 0);
+	}
+
+	return a.get();
+}
+
+AddIn xai_table_rows(
+	Function(XLL_LPOPER, "xll_table_rows", "TABLE.ROWS")
+	.Arguments({
+		Arg(XLL_HANDLEX, "table", "is a handle returned by \\CSV.TABLE."),
+		Arg(XLL_LONG, "_from", "is the optional 0-based index of the first row. Default is 0."),
+		Arg(XLL_LONG, "_count", "is the optional number of rows to return. Default is all remaining rows."),
+		})
+	.Category("CSV")
+	.FunctionHelp("Return rows of table.")
+	.Documentation(R"xyzyx(
+Only the values in the rows returned are converted.
+)xyzyx")
+);
+LPOPER WINAPI xll_table_rows(HANDLEX h, LONG from, LONG count)
+{
+#pragma XLLEXPORT
+	static OPER o;
+
+	try {
+		handle<table> t_(h);
+		ensure(t_);
+		const auto& t = *t_;
+		ensure(from >= 0 || !__FUNCTION__ ": from must be non-negative");
+
+		auto b = std::min(static_cast<size_t>(from), t.rows());
+		auto n = t.rows() - b;
+		if (count > 0) {
+			n = std::min(n, static_cast<size_t>(count));
+		}
+		if (n == 0) {
+			o = ErrNA;
+		}
+		else {
+			o = OPER(static_cast<unsigned>(n), static_cast<unsigned>(t.size()));
+			for (unsigned j = 0; j < t.size(); ++j) {
+				for (unsigned i = 0; i < n; ++i) {
+					o(i, j) = t.cell(b + i, j);
+				}
+			}
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		o = ErrNA;
+	}
+
+	return &o;
+}
+
+#ifdef _DEBUG
+
+Auto<OpenAfter> xaoa_csv_table_test([]() {
+	try {
+		ensure(0 == fms::hash::test());
+		ensure(0 == fms::columns::test());
+
+		static char csv[] = "date,px,n,name\r\n2021-01-04,1.5,3,a\r\n2021-01-05,,4,\"b,c\"\r\n2021-01-06,2,5,a\r\n";
+		handle<fms::view<char>> v_(new shared_view<char>(std::make_shared<fms::view<char>>(csv, sizeof(csv) - 1)));
+		OPER missing;
+		handle<table> t_(xll_csv_table(v_.get(), &missing, "", "", "", ""));
+		ensure(t_);
+		const auto& t = dynamic_cast<const columnar&>(*t_);
+		ensure(t.rows() == 3 and t.size() == 4);
+		ensure(t[0].t == columnar::type::date and t[0].num[0] == 44200);
+		ensure(t[1].t == columnar::type::number and std::isnan(t[1].num[1]));
+		ensure(t[2].t == columnar::type::integer and t[2].i64[2] == 5);
+		ensure(t[3].t == columnar::type::string and t[3].dictionary.size() == 2);
+		ensure(t.find(OPER("name")) == 3 and t.find(OPER("x")) == 4);
+
+		OPER name("name");
+		OPER c = *xll_table_column(t_.get(), &name);
+		ensure(c.rows() == 3 and c[1] == "b,c" and c[2] == "a");
+		OPER r = *xll_table_rows(t_.get(), 1, 1);
+		ensure(r.rows() == 1 and r.columns() == 4);
+		ensure(r(0, 1) == OPER(ErrNA) and r(0, 2) == 4);
+
+		// the second table is mapped from the cache the first one wrote
+		char path[MAX_PATH];
+		auto n = GetTempPathA(MAX_PATH, path);
+		ensure(n and n + 64 < MAX_PATH);
+		strcat_s(path, "xll_csv_table_test.cache");
+		cache::remove(path);
+		handle<table> p_(xll_csv_table(v_.get(), &missing, "", "", "", path));
+		ensure(p_ and dynamic_cast<columnar*>(p_.ptr()));
+		handle<table> q_(xll_csv_table(v_.get(), &missing, "", "", "", path));
+		ensure(q_ and dynamic_cast<cache::cached*>(q_.ptr()));
+		auto same = [](const OPER& o, const OPER& p) {
+			ensure(o.size() == p.size());
+			for (unsigned i = 0; i < o.size(); ++i) {
+				ensure(o[i] == p[i]);
+			}
+		};
+		OPER o = *xll_table_columns(t_.get());
+		same(o, *xll_table_columns(q_.get()));
+		o = *xll_table_rows(t_.get(), 0, 0);
+		same(o, *xll_table_rows(q_.get(), 0, 0));
+		OPER px("px");
+		auto a = xll_table_array(q_.get(), &px);
+		ensure(a == q_->array(1) and a->rows == 3 and a->columns == 1);
+		ensure(a->array[0] == 1.5 and std::isnan(a->array[1]) and a->array[2] == 2);
+
+		// caches are keyed by the source bytes
+		static char more[] = "date,px,n,name\r\n2021-01-04,1.5,3,a\r\n2021-01-05,,4,\"b,c\"\r\n2021-01-06,2,5,a\r\n2021-01-07,3,6,d";
+		auto how = cache::how("table", fms::csv::dialect{}, OPER(1.));
+		ensure(cache::open(path, cache::key(csv, how)));
+		ensure(!cache::open(path, cache::key(more, how))); // stale
+
+		// parsing another way writes a new cache while q_ maps the first
+		OPER no(false);
+		handle<table> r_(xll_csv_table(v_.get(), &no, "", "", "", path));
+		ensure(r_ and dynamic_cast<columnar*>(r_.ptr()));
+		handle<table> s_(xll_csv_table(v_.get(), &no, "", "", "", path));
+		ensure(s_ and dynamic_cast<cache::cached*>(s_.ptr()));
+		o = *xll_table_rows(r_.get(), 0, 0);
+		same(o, *xll_table_rows(s_.get(), 0, 0));
+
+		// append only the new records
+		handle<fms::view<char>> m_(new shared_view<char>(std::make_shared<fms::view<char>>(more, sizeof(more) - 1)));
+		auto offset = t.offset();
+		ensure(xll_table_refresh(t_.get(), m_.get()) == t_.get());
+		ensure(t.rows() == 4 and t.offset() == offset);
+		ensure(t[3].dictionary.size() == 3 and t[0].num[3] == 44203);
+		more[0] = 'D';
+		ensure(xll_table_refresh(t_.get(), m_.get()) == t_.get());
+		ensure(t.rows() == 4 and t[0].name == "Date");
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return FALSE;
+	}
+
+	return TRUE;
+});
+
+#endif // _DEBUG
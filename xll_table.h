@@ -0,0 +1,413 @@
+// xll_table.h - columnar tables of typed arrays
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "fms_csv.h"
+#include "fms_date.h"
+#include "fms_hash.h"
+#include "xll_parse.h"
+#include "xll_utf8.h"
+
+namespace xll {
+
+	// Table of typed columns. Cells are converted to OPERs only when asked for.
+	class table {
+	public:
+		enum class type { integer, number, date, string };
+
+		static const char* name(type t)
+		{
+			switch (t) {
+			case type::integer: return "integer";
+			case type::number: return "number";
+			case type::date: return "date";
+			case type::string: return "string";
+			}
+
+			return "";
+		}
+
+		virtual ~table()
+		{ }
+
+		virtual size_t rows() const = 0;
+		virtual size_t size() const = 0;
+		// name of column j or its index if it has none
+		virtual OPER heading(size_t j) const = 0;
+		virtual type kind(size_t j) const = 0;
+		// row i of column j, #N/A if missing
+		virtual OPER cell(size_t i, size_t j) const = 0;
+		// row i of an integer, number, or date column, NaN if missing
+		virtual double number(size_t i, size_t j) const = 0;
+		// number or date column j as an FP12 without copying or null if it is not stored that way
+		virtual const _FPX* array(size_t) const
+		{
+			return nullptr;
+		}
+		virtual size_t bytes() const = 0;
+
+		// index of column having name or index, size() if not found
+		size_t find(const OPER& key) const
+		{
+			if (key.is_num()) {
+				auto j = key.as_num();
+
+				return 0 <= j and j < size() ? static_cast<size_t>(j) : size();
+			}
+			for (size_t j = 0; j < size(); ++j) {
+				if (heading(j) == key) {
+					return j;
+				}
+			}
+
+			return size();
+		}
+	};
+
+	// Table stored by column. Numbers and dates are arrays of doubles with NaN for
+	// missing values, integers are 64-bit, and strings are indices into a dictionary
+	// of distinct values.
+	class columnar : public table {
+	public:
+		struct column {
+			OPER name;
+			type t = type::integer;
+			std::vector<double> num; // number and date
+			std::vector<int64_t> i64; // integer
+			std::vector<uint32_t> code; // string
+			std::vector<std::string> dictionary;
+
+			size_t bytes() const
+			{
+				size_t n = num.capacity() * sizeof(double) + i64.capacity() * sizeof(int64_t) + code.capacity() * sizeof(uint32_t);
+				for (const auto& s : dictionary) {
+					n += sizeof(s) + s.capacity();
+				}
+
+				return n;
+			}
+
+			void pop_back()
+			{
+				if (t == type::integer) {
+					i64.pop_back();
+				}
+				else if (t == type::string) {
+					code.pop_back();
+				}
+				else {
+					num.pop_back();
+				}
+			}
+
+			OPER operator[](size_t i) const
+			{
+				switch (t) {
+				case type::integer:
+					return OPER(static_cast<double>(i64[i]));
+				case type::number:
+				case type::date:
+					return std::isnan(num[i]) ? OPER(ErrNA) : OPER(num[i]);
+				case type::string:
+					return utf8(dictionary[code[i]]);
+				}
+
+				return ErrNA;
+			}
+		};
+	private:
+		std::vector<column> columns;
+		size_t rows_ = 0;
+
+		static bool integer(std::string_view s, int64_t& i)
+		{
+			if (s.size() and s.front() == '+') {
+				s.remove_prefix(1);
+			}
+			auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), i);
+
+			return s.size() and ec == std::errc{} and ptr == s.data() + s.size();
+		}
+
+		// narrowest type holding both a and b
+		static type widen(type a, type b)
+		{
+			if (a == b) {
+				return a;
+			}
+			if ((a == type::integer and b == type::number) or (a == type::number and b == type::integer)) {
+				return type::number;
+			}
+
+			return type::string;
+		}
+
+		// type of a single field
+		static type classify(std::string_view s)
+		{
+			int64_t i;
+			double x;
+			if (integer(s, i)) {
+				return type::integer;
+			}
+			if (parse::number(s, x)) {
+				return type::number;
+			}
+			if (fms::date::parse(s, x)) {
+				return type::date;
+			}
+
+			return type::string;
+		}
+
+		// true if field f can be stored in a column of type t
+		static bool fits(type t, std::string_view f)
+		{
+			int64_t i;
+			double x;
+			switch (t) {
+			case type::integer:
+				return integer(f, i);
+			case type::number:
+				return f.empty() or parse::number(f, x);
+			case type::date:
+				return f.empty() or fms::date::parse(f, x);
+			case type::string:
+				return true;
+			}
+
+			return false;
+		}
+
+		// field j of record r unquoted and trimmed
+		std::string_view field(std::string_view s, const fms::csv::index& ix, size_t r, size_t j, std::string& tmp) const
+		{
+			return j < ix.fields(r) ? parse::trim(fms::csv::unquote(ix.field(s, r, j), d, tmp)) : std::string_view{};
+		}
+
+		// append records [r0, ix.size()) of s to column j
+		void fill(size_t j, std::string_view s, const fms::csv::index& ix, size_t r0)
+		{
+			auto& col = columns[j];
+			std::string tmp;
+
+			std::unordered_map<std::string, uint32_t> codes;
+			for (uint32_t k = 0; k < col.dictionary.size(); ++k) {
+				codes.emplace(col.dictionary[k], k);
+			}
+			for (size_t r = r0; r < ix.size(); ++r) {
+				auto f = field(s, ix, r, j, tmp);
+				double x = std::numeric_limits<double>::quiet_NaN();
+				int64_t i = 0;
+				switch (col.t) {
+				case type::integer:
+					integer(f, i);
+					col.i64.push_back(i);
+					break;
+				case type::number:
+					if (f.size()) {
+						parse::number(f, x);
+					}
+					col.num.push_back(x);
+					break;
+				case type::date:
+					if (f.size()) {
+						fms::date::parse(f, x);
+					}
+					col.num.push_back(x);
+					break;
+				case type::string: {
+					auto [k, added] = codes.try_emplace(std::string(f), static_cast<uint32_t>(col.dictionary.size()));
+					if (added) {
+						col.dictionary.push_back(k->first);
+					}
+					col.code.push_back(k->second);
+					break;
+				}
+				}
+			}
+		}
+
+		// remember the end of the last complete record of s where rows start at record r0
+		void mark(std::string_view s, const fms::csv::index& ix, size_t r0)
+		{
+			size_t e = 0; // after the last record separator
+			provisional = false;
+			if (auto n = ix.size()) {
+				if (ix.end(n - 1) < s.size()) {
+					e = ix.end(n - 1) + 1;
+				}
+				else {
+					provisional = n > r0;
+					e = n > 1 ? ix.end(n - 2) + 1 : 0;
+				}
+			}
+			prefix.update(s.substr(0, e));
+			parsed += e;
+		}
+
+		fms::csv::dialect d;
+		bool header;
+		size_t parsed = 0; // bytes in complete records
+		bool provisional = false; // last row has no record separator and may grow
+		fms::hash::digest prefix; // of the bytes parsed
+	public:
+		// Parse CSV text into columns. Column types are the narrowest type
+		// holding every nonempty field. Empty fields in integer columns make
+		// them number columns.
+		columnar(std::string_view s, const fms::csv::dialect& d = {}, bool header = true)
+			: d(d), header(header)
+		{
+			fms::csv::index ix(s, d, std::thread::hardware_concurrency());
+			std::string tmp;
+
+			size_t c = 0;
+			for (size_t r = 0; r < ix.size(); ++r) {
+				c = std::max(c, ix.fields(r));
+			}
+			size_t r0 = header and ix.size() ? 1 : 0;
+			rows_ = ix.size() - r0;
+			columns.resize(c);
+
+			for (size_t j = 0; j < c; ++j) {
+				auto& col = columns[j];
+				if (r0 and j < ix.fields(0)) {
+					col.name = utf8(fms::csv::unquote(ix.field(s, 0, j), d, tmp));
+				}
+				else {
+					col.name = OPER(static_cast<double>(j));
+				}
+
+				bool typed = false, empty = false;
+				for (size_t r = r0; r < ix.size() and col.t != type::string; ++r) {
+					auto f = field(s, ix, r, j, tmp);
+					if (f.empty()) {
+						empty = true;
+					}
+					else {
+						auto t = classify(f);
+						col.t = typed ? widen(col.t, t) : t;
+						typed = true;
+					}
+				}
+				if (!typed) {
+					col.t = type::string;
+				}
+				else if (empty and col.t == type::integer) {
+					col.t = type::number;
+				}
+
+				fill(j, s, ix, r0);
+			}
+			mark(s, ix, r0);
+		}
+
+		// Parse only the bytes of s after the last complete record if s starts
+		// with the bytes already parsed. Return false if s does not or if the
+		// new records do not fit the columns and the table is unchanged.
+		bool append(std::string_view s)
+		{
+			if (s.size() < parsed or fms::hash::of(s.substr(0, parsed)) != prefix.value()) {
+				return false;
+			}
+
+			auto tail = s.substr(parsed);
+			fms::csv::index ix(tail, d, std::thread::hardware_concurrency());
+			std::string tmp;
+			size_t r0 = parsed == 0 and header and ix.size() ? 1 : 0;
+			for (size_t r = r0; r < ix.size(); ++r) {
+				if (ix.fields(r) > size()) {
+					return false;
+				}
+				for (size_t j = 0; j < size(); ++j) {
+					if (!fits(columns[j].t, field(tail, ix, r, j, tmp))) {
+						return false;
+					}
+				}
+			}
+
+			if (provisional) {
+				for (auto& col : columns) {
+					col.pop_back();
+				}
+				--rows_;
+			}
+			for (size_t j = 0; j < size(); ++j) {
+				fill(j, tail, ix, r0);
+			}
+			rows_ += ix.size() - r0;
+			mark(tail, ix, r0);
+
+			return true;
+		}
+
+		// Append the new records of s or parse all of s if it does not start
+		// with the bytes parsed. Return true if only new bytes were parsed.
+		bool refresh(std::string_view s)
+		{
+			if (append(s)) {
+				return true;
+			}
+			*this = columnar(s, d, header);
+
+			return false;
+		}
+
+		// bytes of complete records parsed
+		size_t offset() const
+		{
+			return parsed;
+		}
+
+		size_t rows() const override
+		{
+			return rows_;
+		}
+		size_t size() const override
+		{
+			return columns.size();
+		}
+		const column& operator[](size_t j) const
+		{
+			return columns[j];
+		}
+
+		OPER heading(size_t j) const override
+		{
+			return columns[j].name;
+		}
+		type kind(size_t j) const override
+		{
+			return columns[j].t;
+		}
+		OPER cell(size_t i, size_t j) const override
+		{
+			return columns[j][i];
+		}
+		double number(size_t i, size_t j) const override
+		{
+			const auto& col = columns[j];
+
+			return col.t == type::integer ? static_cast<double>(col.i64[i]) : col.num[i];
+		}
+
+		size_t bytes() const override
+		{
+			size_t n = sizeof(*this);
+			for (const auto& col : columns) {
+				n += sizeof(col) + col.bytes();
+			}
+
+			return n;
+		}
+	};
+
+} // namespace xll
@@ -0,0 +1,67 @@
+// xll_utf8.h - OPER strings from and to UTF-8
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include "xll/xll/xll.h"
+#include "fms_charset.h"
+#include "fms_utf8.h"
+
+namespace xll {
+
+	// String OPER from UTF-8 text or #VALUE! if longer than Excel allows.
+	// Invalid UTF-8 becomes U+FFFD.
+	inline OPER utf8(std::string_view s)
+	{
+		if constexpr (sizeof(TCHAR) == 1) {
+			return s.size() <= traits<XLOPERX>::charmax ? OPER(s.data(), static_cast<unsigned>(s.size())) : OPER(ErrValue);
+		}
+		else {
+			// UTF-16 is never longer than UTF-8
+			if (s.size() > 4 * traits<XLOPERX>::charmax) {
+				return ErrValue;
+			}
+			thread_local std::vector<TCHAR> buf;
+			if (buf.size() < s.size()) {
+				buf.resize(s.size());
+			}
+			auto n = fms::utf8::to_utf16(s, buf.data());
+
+			return n <= traits<XLOPERX>::charmax ? OPER(buf.data(), static_cast<TCHAR>(n)) : OPER(ErrValue);
+		}
+	}
+	// #N/A if s is null
+	inline OPER utf8(const char* s)
+	{
+		return s ? utf8(std::string_view(s)) : OPER(ErrNA);
+	}
+
+	// UTF-8 of a string OPER, empty if o is not a string
+	inline std::string to_utf8(const OPER& o)
+	{
+		std::string s;
+
+		if (!o.is_str()) {
+			return s;
+		}
+		if constexpr (sizeof(TCHAR) == 1) {
+			s.assign(o.val.str + 1, static_cast<unsigned char>(o.val.str[0]));
+		}
+		else {
+			size_t n = o.val.str[0];
+			for (size_t i = 1; i <= n; ++i) {
+				char32_t c = o.val.str[i];
+				if (0xD800 <= c and c < 0xDC00 and i < n and 0xDC00 <= o.val.str[i + 1] and o.val.str[i + 1] < 0xE000) {
+					c = 0x10000 + ((c - 0xD800) << 10) + (o.val.str[++i] - 0xDC00);
+				}
+				else if (0xD800 <= c and c < 0xE000) {
+					c = 0xFFFD;
+				}
+				fms::charset::append(s, c);
+			}
+		}
+
+		return s;
+	}
+
+} // namespace xll
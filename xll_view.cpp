@@ -0,0 +1,957 @@
+// xll_view.cpp - views of memory returned by \URL.VIEW
+#include <chrono>
+#ifdef _DEBUG
+#include <regex>
+#endif
+#include "fms_regex.h"
+#include "fms_search.h"
+#include "xll_utf8.h"
+#include "xll_view.h"
+#include "xll_inet.h"
+
+using namespace xll;
+
+// UTF-8 text of an argument compared against views, numbers are converted to text like Excel does
+inline std::string utf8_arg(const OPER& o)
+{
+    return to_utf8(o.is_str() ? o : Excel(xlCoerce, o, OPER(static_cast<double>(xltypeStr))));
+}
+
+// clamp offset and count to v, negative offset is from the end, count <= 0 is the rest
+inline std::pair<size_t, size_t> range(const fms::view<char>& v, LONG off, LONG count)
+{
+    size_t o = off >= 0 ? off : (static_cast<size_t>(-off) > v.len ? 0 : v.len + off);
+    if (o > v.len) {
+        o = v.len;
+    }
+    size_t n = v.len - o;
+    if (count > 0 and static_cast<size_t>(count) < n) {
+        n = count;
+    }
+
+    return { o, n };
+}
+
+AddIn xai_view(
+    Function(XLL_LPOPER, "xll_view", "VIEW")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\URL.VIEW."),
+        Arg(XLL_LONG, "_offset", "is the view offset. Default is 0."),
+        Arg(XLL_LONG, "_count", "is the number of characters to return. Default is all.")
+        })
+    .FunctionHelp("Return substring of view.")
+    .Category(CATEGORY)
+    .Documentation(R"xyzyx(
+Drop <code>_offset</code> and take <code>_count</code> charaters from a view.
+A negative offset is from the end of the view. A UTF-8 byte order mark at the
+start of the view is skipped. The view is not modified.
+)xyzyx")
+);
+LPOPER WINAPI xll_view(HANDLEX h, LONG off, LONG len)
+{
+#pragma XLLEXPORT
+    static OPER result;
+
+    try {
+        auto v = resident<char>(h);
+
+        auto u = text(*v);
+        auto [o, n] = range(u, off, len);
+
+        result = utf8(std::string_view(u.buf + o, n));
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        result = ErrNA;
+    }
+
+    return &result;
+}
+
+// line index of the text of v
+inline const fms::lines& line_index(shared_view<char>& v)
+{
+    if (!v.lines) {
+        auto u = text(v);
+        v.lines = std::make_unique<fms::lines>(std::string_view(u.buf, u.len));
+    }
+
+    return *v.lines;
+}
+
+inline OPER line(shared_view<char>& v, size_t n)
+{
+    auto u = text(v);
+
+    return utf8(line_index(v).line(std::string_view(u.buf, u.len), n));
+}
+
+AddIn xai_view_line(
+    Function(XLL_LPOPER, "xll_view_line", "VIEW.LINE")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\URL.VIEW or VIEW.SLICE."),
+        Arg(XLL_LONG, "n", "is the 0-based line number."),
+        })
+    .FunctionHelp("Return line n of a view.")
+    .Category(CATEGORY)
+    .Documentation(R"xyzyx(
+Return line <code>n</code> of the view without the line ending or <code>#N/A</code>
+if the view has fewer lines. Lines end with <code>"\n"</code> or <code>"\r\n"</code>.
+<p>
+The first call on a view builds an index of line offsets
+so later calls take the same time for any line.
+</p>
+)xyzyx")
+);
+LPOPER WINAPI xll_view_line(HANDLEX h, LONG n)
+{
+#pragma XLLEXPORT
+    static OPER result;
+
+    try {
+        auto v = shared<char>(h);
+        ensure(n >= 0 || !__FUNCTION__ ": line number must be non-negative");
+
+        result = static_cast<size_t>(n) < line_index(*v).size() ? line(*v, n) : OPER(ErrNA);
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        result = ErrNA;
+    }
+
+    return &result;
+}
+
+AddIn xai_view_lines(
+    Function(XLL_LPOPER, "xll_view_lines", "VIEW.LINES")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\URL.VIEW or VIEW.SLICE."),
+        Arg(XLL_LONG, "_from", "is the 0-based number of the first line. Default is 0."),
+        Arg(XLL_LONG, "_count", "is the number of lines to return. Default is all."),
+        })
+    .FunctionHelp("Return a column of lines of a view.")
+    .Category(CATEGORY)
+    .Documentation(R"xyzyx(
+Return <code>_count</code> lines starting at line <code>_from</code>
+using the same index as <code>VIEW.LINE</code>.
+)xyzyx")
+);
+LPOPER WINAPI xll_view_lines(HANDLEX h, LONG from, LONG count)
+{
+#pragma XLLEXPORT
+    static OPER result;
+
+    try {
+        auto v = shared<char>(h);
+        ensure(from >= 0 || !__FUNCTION__ ": first line must be non-negative");
+
+        auto size = line_index(*v).size();
+        size_t n = static_cast<size_t>(from) < size ? size - from : 0;
+        if (count > 0 and static_cast<size_t>(count) < n) {
+            n = count;
+        }
+        ensure(n <= 1048576 || !__FUNCTION__ ": more lines than Excel rows");
+
+        if (n == 0) {
+            result = ErrNA;
+        }
+        else {
+            result = OPER(static_cast<unsigned>(n), 1);
+            for (size_t i = 0; i < n; ++i) {
+                result(static_cast<unsigned>(i), 0) = line(*v, from + i);
+            }
+        }
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        result = ErrNA;
+    }
+
+    return &result;
+}
+
+AddIn xai_view_len(
+    Function(XLL_LPOPER, "xll_view_len", "VIEW.LEN")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle to a view of memory."),
+        })
+    .FunctionHelp("Return the number of characters in a view.")
+    .Category(CATEGORY)
+    .Documentation(R"xyzyx(
+The function <code>\INET.READ</code> returns a view.
+)xyzyx")
+);
+LPOPER WINAPI xll_view_len(HANDLEX h)
+{
+#pragma XLLEXPORT
+    static OPER result;
+
+    try {
+        handle<fms::view<char>> h_(h);
+        ensure(h_ || !"VIEW.LEN: unrecognized handle");
+
+        result = h_->len;
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        result = ErrNA;
+    }
+
+    return &result;
+}
+
+AddIn xai_view_slice(
+    Function(XLL_HANDLEX, "xll_view_slice", "VIEW.SLICE")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\URL.VIEW or VIEW.SLICE."),
+        Arg(XLL_LONG, "offset", "is the offset of the slice. Negative values are from the end."),
+        Arg(XLL_LONG, "_len", "is the number of characters in the slice. Default is the rest of the view."),
+        })
+    .Uncalced()
+    .FunctionHelp("Return a handle to part of a view.")
+    .Category(CATEGORY)
+    .Documentation(R"xyzyx(
+Offsets are the same as for <code>VIEW</code>.
+The slice refers to the same memory as <code>handle</code> so no data is copied.
+The memory is released when the last view referring to it is deleted.
+The view <code>handle</code> is not modified so any number of cells can slice the same view.
+)xyzyx")
+);
+HANDLEX WINAPI xll_view_slice(HANDLEX h, LONG off, LONG len)
+{
+#pragma XLLEXPORT
+    try {
+        auto v = shared<char>(h);
+        auto [o, n] = range(text(*v), off, len);
+
+        handle<fms::view<char>> h_(new shared_view<char>(*v, bom(*v) + o, n));
+
+        h = h_.get();
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        h = INVALID_HANDLEX;
+    }
+
+    return h;
+}
+
+AddIn xai_view_drop(
+    Function(XLL_HANDLEX, "xll_view_drop", "VIEW.DROP")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle returned by \\URL.VIEW."),
+        Arg(XLL_LONG, "count", "number or characters to drop from beginning (count > 0) or end (count < 0) of view"),
+        })
+    .Uncalced()
+    .FunctionHelp("Return handle with dropped characters.")
+    .Category(CATEGORY)
+    .Documentation(R"xyzyx(
+Drop from the beginning if <code>count > 0</code>
+or end if <code>count < 0</code> of view.
+This returns a new view as in <code>VIEW.SLICE</code> and does not modify <code>handle</code>.
+)xyzyx")
+);
+HANDLEX WINAPI xll_view_drop(HANDLEX h, LONG count)
+{
+#pragma XLLEXPORT
+    try {
+        auto v = shared<char>(h);
+        auto b = bom(*v);
+        size_t n = count >= 0 ? count : -count;
+        if (n > v->len - b) {
+            n = v->len - b;
+        }
+
+        handle<fms::view<char>> h_(count >= 0
+            ? new shared_view<char>(*v, b + n, v->len - b - n)
+            : new shared_view<char>(*v, b, v->len - b - n));
+
+        h = h_.get();
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        h = INVALID_HANDLEX;
+    }
+
+    return h;
+}
+
+AddIn xai_view_concat(
+    Function(XLL_HANDLEX, "xll_view_concat", "\\VIEW.CONCAT")
+    .Arguments({
+        Arg(XLL_LPOPER, "views", "is a range of handles to views or ropes."),
+        })
+    .Uncalced()
+    .FunctionHelp("Return a handle to a rope of views.")
+    .Category(CATEGORY)
+    .Documentation(R"xyzyx(
+A rope presents the views in <code>views</code> as one view without copying them.
+Use it to combine the pages of a paginated download.
+A UTF-8 byte order mark at the start of each view is dropped.
+<p>
+<code>CSV.PARSE</code> and <code>JSON.PARSE</code> read a rope one segment at a time.
+Other view functions make a contiguous copy of the rope the first time they are called on it.
+</p>
+)xyzyx")
+);
+HANDLEX WINAPI xll_view_concat(LPOPER pviews)
+{
+#pragma XLLEXPORT
+    HANDLEX h = INVALID_HANDLEX;
+
+    try {
+        // registered as a handle only after every view is appended
+        std::unique_ptr<rope_view<char>> r(new rope_view<char>);
+        for (const auto& v : *pviews) {
+            ensure(v.is_num() || !__FUNCTION__ ": views must be handles");
+            if (auto r_ = rope<char>(v.as_num())) {
+                r->append(*r_);
+            }
+            else {
+                auto s = shared<char>(v.as_num());
+                r->append(*s, bom(*s), s->len - bom(*s));
+            }
+        }
+
+        handle<fms::view<char>> h_(r.release());
+        h = h_.get();
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+    }
+
+    return h;
+}
+
+AddIn xai_view_find(
+    Function(XLL_LPOPER, "xll_view_find", "VIEW.FIND")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle to a view."),
+        Arg(XLL_LPOPER, "needle", "is the text to find."),
+        Arg(XLL_LONG, "_start", "is the offset at which to start searching. Default is 0."),
+        })
+    .FunctionHelp("Return the offset of needle in a view.")
+    .Category(CATEGORY)
+    .Documentation(R"xyzyx(
+Return the offset of the first occurence of <code>needle</code> at or after
+<code>_start</code> or <code>#N/A</code> if not found. A negative start is
+from the end of the view. Offsets are the same as for <code>VIEW</code>
+and <code>VIEW.SLICE</code> so <code>VIEW(view, VIEW.FIND(view, needle))</code>
+returns the text starting at <code>needle</code>.
+<p>
+The view is searched using SIMD instructions without copying it into Excel.
+</p>
+)xyzyx")
+);
+LPOPER WINAPI xll_view_find(HANDLEX h, LPOPER pneedle, LONG start)
+{
+#pragma XLLEXPORT
+    static OPER result;
+
+    try {
+        auto v = resident<char>(h);
+
+        auto u = text(*v);
+        auto [o, n] = range(u, start, 0);
+        auto i = fms::search::find(std::string_view(u.buf, u.len), utf8_arg(*pneedle), o);
+
+        result = i == std::string_view::npos ? OPER(ErrNA) : OPER(static_cast<double>(i));
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        result = ErrNA;
+    }
+
+    return &result;
+}
+
+AddIn xai_view_count(
+    Function(XLL_LPOPER, "xll_view_count", "VIEW.COUNT")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle to a view."),
+        Arg(XLL_LPOPER, "needle", "is the text to count."),
+        })
+    .FunctionHelp("Return the number of occurences of needle in a view.")
+    .Category(CATEGORY)
+    .Documentation(R"xyzyx(
+Return the number of non-overlapping occurences of <code>needle</code> in the view.
+For example, <code>VIEW.COUNT(view, CHAR(10))</code> is the number of lines.
+)xyzyx")
+);
+LPOPER WINAPI xll_view_count(HANDLEX h, LPOPER pneedle)
+{
+#pragma XLLEXPORT
+    static OPER result;
+
+    try {
+        auto v = resident<char>(h);
+
+        auto u = text(*v);
+        result = static_cast<double>(fms::search::count(std::string_view(u.buf, u.len), utf8_arg(*pneedle)));
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        result = ErrNA;
+    }
+
+    return &result;
+}
+
+AddIn xai_view_chunks(
+    Function(XLL_LPOPER, "xll_view_chunks", "VIEW.CHUNKS")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle to a view."),
+        Arg(XLL_LONG, "_size", "is the maximum number of characters in each chunk. Default is 32767."),
+        Arg(XLL_BOOL, "_lines", "is an optional boolean indicating chunks should end at line boundaries. Default is FALSE."),
+        })
+    .FunctionHelp("Return a column of strings containing the entire view.")
+    .Category(CATEGORY)
+    .Documentation(R"xyzyx(
+Split the view into strings of at most <code>_size</code> characters and return them in a column.
+<code>CONCAT</code> of the result is the entire view.
+Chunks never split a UTF-8 character. If <code>_lines</code> is true then chunks end
+after the last line ending that fits, unless a line is longer than <code>_size</code>.
+)xyzyx")
+);
+LPOPER WINAPI xll_view_chunks(HANDLEX h, LONG size, BOOL lines)
+{
+#pragma XLLEXPORT
+    static OPER result;
+
+    try {
+        auto v = resident<char>(h);
+        if (size <= 0 or size > traits<XLOPERX>::charmax) {
+            size = traits<XLOPERX>::charmax;
+        }
+
+        auto u = text(*v);
+        std::string_view s(u.buf, u.len);
+
+        // chunk boundaries then one allocation for the result
+        std::vector<size_t> ends;
+        for (size_t b = 0; b < s.size(); b = ends.back()) {
+            auto rest = s.substr(b);
+            auto n = fms::utf8::prefix(rest, size);
+            if (lines and n < rest.size()) {
+                if (auto nl = rest.substr(0, n).rfind('\n'); nl != rest.npos) {
+                    n = nl + 1;
+                }
+            }
+            ends.push_back(b + (n ? n : 1));
+            ensure(ends.size() <= 1048576 || !__FUNCTION__ ": more chunks than Excel rows");
+        }
+
+        if (ends.empty()) {
+            result = OPER(_T(""));
+        }
+        else {
+            result = OPER(static_cast<unsigned>(ends.size()), 1);
+            size_t b = 0;
+            for (unsigned i = 0; i < ends.size(); ++i) {
+                result(i, 0) = utf8(s.substr(b, ends[i] - b));
+                b = ends[i];
+            }
+        }
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        result = ErrNA;
+    }
+
+    return &result;
+}
+
+// compiled patterns for VIEW.REGEX
+static fms::regex::cache regexes;
+
+// offset to search from after match cap in s
+// an empty match moves to the start of the next UTF-8 code point
+inline size_t next_search(std::string_view s, const std::vector<size_t>& cap)
+{
+    if (cap[1] > cap[0]) {
+        return cap[1];
+    }
+    size_t i = cap[1] + 1;
+    while (i < s.size() and (static_cast<unsigned char>(s[i]) & 0xC0) == 0x80) {
+        ++i;
+    }
+
+    return i;
+}
+
+AddIn xai_view_regex(
+    Function(XLL_LPOPER, "xll_view_regex", "VIEW.REGEX")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle to a view."),
+        Arg(XLL_LPOPER, "pattern", "is a regular expression."),
+        Arg(XLL_LPOPER, "_group", "is an optional capture group to return. Default is all groups."),
+        })
+    .FunctionHelp("Return all matches of a regular expression in a view.")
+    .Category(CATEGORY)
+    .Documentation(R"xyzyx(
+Return one row for each non-overlapping match of <code>pattern</code> in the view.
+If <code>_group</code> is missing the columns are the capture groups of the pattern,
+or the whole match if it has none. Otherwise return the column for group <code>_group</code>
+where group 0 is the whole match. Groups that do not participate in a match are <code>#N/A</code>.
+<p>
+Patterns support literals, <code>.</code>, <code>[...]</code>, <code>[^...]</code>,
+<code>\d \w \s \D \W \S</code>, <code>\n \r \t \xHH</code>,
+<code>^</code> and <code>$</code> at line boundaries, <code>(...)</code>, <code>(?:...)</code>,
+<code>|</code>, and <code>* + ? {m} {m,} {m,n}</code> with lazy versions <code>*? +? ?? {m,n}?</code>.
+There are no backreferences or lookaround so each search is linear in the length of the view.
+Finding all matches starts a new search after each match, so a pattern such as <code>a*b|a</code>
+on a long run of <code>a</code> takes time quadratic in the length of the run.
+Compiled patterns are cached so recalculation does not compile them again.
+</p>
+)xyzyx")
+);
+LPOPER WINAPI xll_view_regex(HANDLEX h, LPOPER ppattern, LPOPER pgroup)
+{
+#pragma XLLEXPORT
+    static OPER result;
+
+    try {
+        auto v = resident<char>(h);
+
+        auto prog = regexes.get(utf8_arg(*ppattern));
+        fms::regex::matcher m(*prog);
+
+        std::vector<unsigned> groups;
+        if (pgroup->is_missing() or pgroup->is_nil()) {
+            for (unsigned g = prog->groups() ? 1 : 0; g <= prog->groups(); ++g) {
+                groups.push_back(g);
+            }
+        }
+        else {
+            ensure((pgroup->is_num() and pgroup->as_num() >= 0 and pgroup->as_num() <= prog->groups())
+                || !__FUNCTION__ ": group must be a capture group number of the pattern");
+            groups.push_back(static_cast<unsigned>(pgroup->as_num()));
+        }
+
+        auto u = text(*v);
+        std::string_view s(u.buf, u.len);
+        std::vector<size_t> cap, caps; // captures of each match
+        size_t rows = 0;
+        for (size_t i = 0; rows < 1048576 and i <= s.size() and m.search(s, i, cap); ++rows) {
+            caps.insert(caps.end(), cap.begin(), cap.end());
+            i = next_search(s, cap);
+        }
+
+        if (rows == 0) {
+            result = ErrNA;
+        }
+        else {
+            result = OPER(static_cast<unsigned>(rows), static_cast<unsigned>(groups.size()));
+            for (size_t r = 0; r < rows; ++r) {
+                const size_t* c = caps.data() + r * cap.size();
+                for (unsigned j = 0; j < groups.size(); ++j) {
+                    auto b = c[2 * groups[j]], e = c[2 * groups[j] + 1];
+                    result(static_cast<unsigned>(r), j) = b == s.npos ? OPER(ErrNA) : utf8(s.substr(b, e - b));
+                }
+            }
+        }
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        result = ErrNA;
+    }
+
+    return &result;
+}
+
+AddIn xai_view_idle(
+    Function(XLL_DOUBLE, "xll_view_idle", "VIEW.IDLE")
+    .Arguments({
+        Arg(XLL_LPOPER, "_seconds", "is an optional idle time in seconds after which views are packed."),
+        })
+    .FunctionHelp("Set or return the idle time before views are compressed in memory.")
+    .Category(CATEGORY)
+    .Documentation(R"xyzyx(
+Views not used for <code>_seconds</code> are compressed in place and their memory
+is released. The next function that reads the view expands it again. Idle views are
+packed whenever a view function is called and when this function sets the idle time.
+An idle time of 0 turns packing off. The default is 600 seconds.
+If <code>_seconds</code> is missing the current idle time is returned.
+)xyzyx")
+);
+double WINAPI xll_view_idle(LPOPER pseconds)
+{
+#pragma XLLEXPORT
+    try {
+        if (pseconds->is_num()) {
+            ensure(pseconds->as_num() >= 0 || !__FUNCTION__ ": idle time must be non-negative");
+            idle_time = std::chrono::seconds(static_cast<long long>(pseconds->as_num()));
+            pack_idle<char>();
+        }
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+    }
+
+    return static_cast<double>(idle_time.count());
+}
+
+AddIn xai_view_memory(
+    Function(XLL_LPOPER, "xll_view_memory", "VIEW.MEMORY")
+    .Arguments({
+        Arg(XLL_HANDLEX, "_handle", "is an optional handle to a view."),
+        })
+    .FunctionHelp("Return the memory used by a view or by all views.")
+    .Category(CATEGORY)
+    .Documentation(R"xyzyx(
+Return a two column range of keys and values for the buffer of a view:
+<code>bytes</code> is the uncompressed size, <code>resident</code> is the number
+of bytes in memory, <code>packed</code> is true if the view is compressed,
+<code>ratio</code> is the compression ratio of the last packing, and
+<code>idle</code> is the number of seconds since the view was used.
+Slices share the buffer of the view they were taken from.
+<p>
+If <code>_handle</code> is missing return the number of <code>buffers</code> shared by all views
+and the total <code>bytes</code> and <code>resident</code> memory of all of them
+and the number that are <code>packed</code>.
+</p>
+)xyzyx")
+);
+LPOPER WINAPI xll_view_memory(HANDLEX h)
+{
+#pragma XLLEXPORT
+    static OPER result;
+
+    try {
+        result = OPER(5, 2);
+        if (h == 0) {
+            pack_idle<char>(); // drop buffers of deleted views
+            double bytes = 0, resident = 0, packed = 0;
+            for (const auto& w : buffers<char>()) {
+                if (auto b = w.lock()) {
+                    bytes += b->bytes();
+                    resident += b->resident();
+                    packed += b->is_packed();
+                }
+            }
+            result(0, 0) = "buffers";
+            result(0, 1) = static_cast<double>(buffers<char>().size());
+            result(1, 0) = "bytes";
+            result(1, 1) = bytes;
+            result(2, 0) = "resident";
+            result(2, 1) = resident;
+            result(3, 0) = "packed";
+            result(3, 1) = packed;
+            result(4, 0) = "ratio";
+            result(4, 1) = resident ? bytes / resident : 1.;
+        }
+        else {
+            // do not unpack the view to measure it
+            handle<fms::view<char>> v(h);
+            ensure(v || !__FUNCTION__ ": unrecognized handle");
+            auto s = dynamic_cast<shared_view<char>*>(v.ptr());
+            auto b = s ? s->buffer.get() : nullptr;
+            auto r = dynamic_cast<rope_view<char>*>(v.ptr()); // resident only if flattened
+
+            result(0, 0) = "bytes";
+            result(0, 1) = static_cast<double>(b ? b->bytes() : v->len);
+            result(1, 0) = "resident";
+            result(1, 1) = static_cast<double>(b ? b->resident() : r ? (r->flat and r->flat->data ? r->len : 0) : v->len);
+            result(2, 0) = "packed";
+            result(2, 1) = OPER(b and b->is_packed());
+            result(3, 0) = "ratio";
+            result(3, 1) = b and b->ratio() ? OPER(b->ratio()) : OPER(ErrNA);
+            result(4, 0) = "idle";
+            result(4, 1) = b ? std::chrono::duration<double>(b->idle()).count() : 0.;
+        }
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        result = ErrNA;
+    }
+
+    return &result;
+}
+
+#ifdef _DEBUG
+
+AddIn xai_view_find_benchmark(
+    Function(XLL_LPOPER, "xll_view_find_benchmark", "VIEW.FIND.BENCHMARK")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle to a view."),
+        Arg(XLL_LPOPER, "needle", "is the text to find."),
+        })
+    .Category(CATEGORY)
+    .FunctionHelp("Return GB/s of VIEW.FIND and std::string_view::find.")
+    .Documentation(R"xyzyx(
+Count all occurences of <code>needle</code> using both methods
+and return a two column range of the method name and GB/s.
+)xyzyx")
+);
+LPOPER WINAPI xll_view_find_benchmark(HANDLEX h, LPOPER pneedle)
+{
+#pragma XLLEXPORT
+    static OPER result;
+
+    try {
+        auto v = resident<char>(h);
+
+        auto needle = utf8_arg(*pneedle);
+        std::string_view s(v->buf, v->len), n(needle);
+
+        result = OPER(2, 2);
+        result(0, 0) = "VIEW.FIND";
+        result(0, 1) = gbs(s.size(), [&]() { return fms::search::count(s, n); });
+        result(1, 0) = "std::string_view::find";
+        result(1, 1) = gbs(s.size(), [&]() {
+            size_t m = 0;
+            for (auto i = s.find(n); n.size() and i != s.npos; i = s.find(n, i + n.size())) {
+                ++m;
+            }
+            return m;
+        });
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        result = ErrNA;
+    }
+
+    return &result;
+}
+
+AddIn xai_view_utf8_benchmark(
+    Function(XLL_LPOPER, "xll_view_utf8_benchmark", "VIEW.UTF8.BENCHMARK")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle to a view."),
+        })
+    .Category(CATEGORY)
+    .FunctionHelp("Return GB/s of UTF-8 transcoding and narrow OPER strings.")
+    .Documentation(R"xyzyx(
+Convert the view to <code>OPER</code> strings of at most 32767 bytes
+using <code>utf8</code> and the <code>OPER(const char*, len)</code> constructor
+and return a two column range of the method name and GB/s.
+)xyzyx")
+);
+LPOPER WINAPI xll_view_utf8_benchmark(HANDLEX h)
+{
+#pragma XLLEXPORT
+    static OPER result;
+
+    try {
+        auto v = resident<char>(h);
+
+        std::string_view s(v->buf, v->len);
+        auto pieces = [&s](auto&& f) {
+            size_t n = 0;
+            for (size_t i = 0; i < s.size(); i += traits<XLOPERX>::charmax) {
+                n += f(s.substr(i, traits<XLOPERX>::charmax)).xltype;
+            }
+            return n;
+        };
+
+        result = OPER(2, 2);
+        result(0, 0) = "utf8";
+        result(0, 1) = gbs(s.size(), [&]() { return pieces([](std::string_view p) { return utf8(p); }); });
+        result(1, 0) = "OPER(const char*, len)";
+        result(1, 1) = gbs(s.size(), [&]() {
+            return pieces([](std::string_view p) { return OPER(p.data(), static_cast<unsigned>(p.size())); });
+        });
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        result = ErrNA;
+    }
+
+    return &result;
+}
+
+AddIn xai_view_regex_benchmark(
+    Function(XLL_LPOPER, "xll_view_regex_benchmark", "VIEW.REGEX.BENCHMARK")
+    .Arguments({
+        Arg(XLL_HANDLEX, "handle", "is a handle to a view."),
+        Arg(XLL_LPOPER, "pattern", "is a regular expression."),
+        })
+    .Category(CATEGORY)
+    .FunctionHelp("Return GB/s of finding all matches with VIEW.REGEX and std::regex.")
+    .Documentation(R"xyzyx(
+Find all matches of <code>pattern</code> using both methods
+and return a two column range of the method name and GB/s.
+<code>std::regex</code> is only run on the first megabyte of the view
+since it backtracks and can take exponential time.
+)xyzyx")
+);
+LPOPER WINAPI xll_view_regex_benchmark(HANDLEX h, LPOPER ppattern)
+{
+#pragma XLLEXPORT
+    static OPER result;
+
+    try {
+        auto v = resident<char>(h);
+
+        std::string_view s(v->buf, v->len);
+        auto t = s.substr(0, 1 << 20);
+        auto pattern = utf8_arg(*ppattern);
+        auto prog = regexes.get(pattern);
+        std::regex re(pattern);
+
+        result = OPER(2, 2);
+        result(0, 0) = "VIEW.REGEX";
+        result(0, 1) = gbs(s.size(), [&]() {
+            fms::regex::matcher m(*prog);
+            std::vector<size_t> cap;
+            size_t n = 0;
+            for (size_t i = 0; i <= s.size() and m.search(s, i, cap); i = next_search(s, cap)) {
+                ++n;
+            }
+            return n;
+        });
+        result(1, 0) = "std::regex";
+        result(1, 1) = gbs(t.size(), [&]() {
+            return static_cast<size_t>(std::distance(std::cregex_iterator(t.data(), t.data() + t.size(), re), std::cregex_iterator()));
+        });
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        result = ErrNA;
+    }
+
+    return &result;
+}
+
+Auto<OpenAfter> xaoa_view_slice_test([]() {
+    try {
+        static char buf[] = "\xEF\xBB\xBFhello world";
+        std::shared_ptr<fms::view<char>> base(new fms::view<char>(buf, sizeof(buf) - 1));
+        handle<fms::view<char>> h_(new shared_view<char>(base));
+        HANDLEX h = h_.get();
+
+        ensure(*xll_view(h, 0, 0) == "hello world");
+        ensure(*xll_view(h, 6, 0) == "world");
+        ensure(*xll_view(h, -5, 3) == "wor");
+
+        HANDLEX s = xll_view_slice(h, 0, 5);
+        ensure(*xll_view(s, 0, 0) == "hello");
+        ensure(*xll_view_len(s) == 5);
+        HANDLEX t = xll_view_slice(s, 1, 2);
+        ensure(*xll_view(t, 0, 0) == "el");
+
+        HANDLEX d = xll_view_drop(h, -6);
+        ensure(*xll_view(d, 0, 0) == "hello");
+
+        // parent unchanged
+        ensure(*xll_view_len(h) == 14);
+        ensure(*xll_view(h, 0, 5) == "hello");
+
+        OPER o("o"), world("world");
+        ensure(*xll_view_find(h, &o, 0) == 4);
+        ensure(*xll_view_find(h, &o, 5) == 7);
+        ensure(*xll_view_find(h, &o, -3) == ErrNA);
+        ensure(*xll_view_find(h, &world, 0) == 6);
+        ensure(*xll_view_count(h, &o) == 2);
+        ensure(*xll_view_count(s, &o) == 1);
+
+        ensure(0 == fms::search::test());
+        ensure(0 == fms::lines_test());
+        ensure(0 == fms::utf8::test());
+        ensure(0 == fms::regex::test());
+
+        static char cafe[] = "caf\xC3\xA9 \xF0\x9F\x98\x80";
+        handle<fms::view<char>> c_(new shared_view<char>(std::make_shared<fms::view<char>>(cafe, sizeof(cafe) - 1)));
+        ensure(*xll_view(c_.get(), 0, 0) == OPER(_T("caf\u00E9 \U0001F600")));
+        OPER e(_T("\u00E9"));
+        ensure(*xll_view_find(c_.get(), &e, 0) == 3);
+        ensure(*xll_view_count(c_.get(), &e) == 1);
+
+        static char lines[] = "one\r\ntwo\nthree\n";
+        handle<fms::view<char>> l_(new shared_view<char>(std::make_shared<fms::view<char>>(lines, sizeof(lines) - 1)));
+        ensure(*xll_view_line(l_.get(), 1) == "two");
+        ensure(*xll_view_line(l_.get(), 3) == ErrNA);
+        ensure(xll_view_lines(l_.get(), 1, 0)->rows() == 2);
+        ensure((*xll_view_lines(l_.get(), 0, 1))(0, 0) == "one");
+
+        static char kv[] = "a=1, bb=22,c=x, d=4";
+        handle<fms::view<char>> kv_(new shared_view<char>(std::make_shared<fms::view<char>>(kv, sizeof(kv) - 1)));
+        OPER all, kvp("(\\w+)=(\\d+)");
+        OPER kvo = *xll_view_regex(kv_.get(), &kvp, &all);
+        ensure(kvo.rows() == 3 and kvo.columns() == 2);
+        ensure(kvo(1, 0) == "bb" and kvo(1, 1) == "22");
+        OPER g0(0);
+        kvo = *xll_view_regex(kv_.get(), &kvp, &g0);
+        ensure(kvo.columns() == 1 and kvo(2, 0) == "d=4");
+        OPER ep(_T("f\u00E9"));
+        ensure((*xll_view_regex(c_.get(), &ep, &all))(0, 0) == OPER(_T("f\u00E9")));
+        OPER xs("x*"); // empty match at each code point boundary
+        ensure(xll_view_regex(c_.get(), &xs, &all)->rows() == 7);
+
+        OPER ch = *xll_view_chunks(c_.get(), 3, FALSE);
+        ensure(ch.rows() == 3);
+        ensure(ch(0, 0) == "caf" and ch(1, 0) == OPER(_T("\u00E9 ")) and ch(2, 0) == OPER(_T("\U0001F600")));
+        ch = *xll_view_chunks(l_.get(), 10, TRUE);
+        ensure(ch.rows() == 2 and ch(0, 0) == "one\r\ntwo\n" and ch(1, 0) == "three\n");
+
+        // packed buffers unpack on the next access
+        static std::string rows = []() {
+            std::string s;
+            for (int i = 0; i < 100; ++i) {
+                s.append("2021-01-01,1.23\n");
+            }
+            return s;
+        }();
+        handle<fms::view<char>> p_(new shared_view<char>(std::make_shared<fms::view<char>>(rows.data(), rows.size())));
+        HANDLEX q = xll_view_slice(p_.get(), 16, 15);
+        ensure(shared<char>(p_.get())->buffer->pack() > rows.size() / 2);
+        ensure((*xll_view_memory(q))(2, 1) == OPER(true));
+        ensure((*xll_view_memory(q))(1, 1).as_num() < rows.size() / 2);
+        ensure(*xll_view(q, 0, 0) == "2021-01-01,1.23");
+        ensure((*xll_view_memory(p_.get()))(2, 1) == OPER(false));
+        ensure(*xll_view_line(p_.get(), 99) == "2021-01-01,1.23");
+        ensure(0 == fms::lz::test());
+
+        // ropes cross segment boundaries
+        static char a[] = "\xEF\xBB\xBF" "ab,c";
+        static char b[] = "d\nef";
+        handle<fms::view<char>> a_(new shared_view<char>(std::make_shared<fms::view<char>>(a, sizeof(a) - 1)));
+        handle<fms::view<char>> b_(new shared_view<char>(std::make_shared<fms::view<char>>(b, sizeof(b) - 1)));
+        OPER ab({ OPER(a_.get()), OPER(b_.get()) });
+        HANDLEX r = xll_view_concat(&ab);
+        ensure(*xll_view_len(r) == 8);
+        auto r_ = rope<char>(r);
+        ensure(r_ and r_->segments.size() == 2);
+        ensure(std::string(r_->begin(), r_->end()) == "ab,cd\nef");
+        ensure((*r_)[3] == 'c' and (*r_)[4] == 'd' and (*r_)[7] == 'f');
+        OPER rb({ OPER(r), OPER(b_.get()) });
+        HANDLEX rr = xll_view_concat(&rb);
+        ensure(rope<char>(rr)->segments.size() == 3);
+        OPER cd("cd");
+        ensure(*xll_view_find(rr, &cd, 0) == 3);
+        ensure(*xll_view(rr, 0, 0) == "ab,cd\nefd\nef");
+
+        // idle copies of ropes are dropped and made again on use
+        ensure((*xll_view_memory(rr))(1, 1).as_num() == 12);
+        auto idle = idle_time;
+        idle_time = std::chrono::seconds(1);
+        rope<char>(rr)->flat->used -= std::chrono::seconds(2);
+        pack_idle<char>();
+        idle_time = idle;
+        ensure((*xll_view_memory(rr))(1, 1).as_num() == 0);
+        ensure(*xll_view(rr, 0, 0) == "ab,cd\nefd\nef");
+    }
+    catch (const std::exception& ex) {
+        XLL_ERROR(ex.what());
+
+        return FALSE;
+    }
+
+    return TRUE;
+});
+
+#endif // _DEBUG
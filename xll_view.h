@@ -0,0 +1,483 @@
+// xll_view.h - views sharing one buffer
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "xll/xll/xll.h"
+#include "fms_parse/win_mem_view.h"
+#include "fms_charset.h"
+#include "fms_csv.h"
+#include "fms_lz.h"
+#include "fms_lines.h"
+
+namespace xll {
+
+	// UTF-8 body of a URL and the encoding it was sent in
+	struct body : public win::mem_view<char> {
+		static constexpr DWORD capacity = 1 << 27; // characters reserved
+		fms::charset::encoding charset = fms::charset::encoding::utf8;
+
+		body()
+			: win::mem_view<char>(INVALID_HANDLE_VALUE, capacity)
+		{ }
+	};
+
+	// pack buffers not accessed for this long, zero turns packing off
+	inline std::chrono::seconds idle_time{ 600 };
+
+	// Buffer shared by a view and its slices. An idle buffer is compressed
+	// and its memory released until the next access unpacks it.
+	template<class T>
+	class shared_buffer {
+		using clock = std::chrono::steady_clock;
+
+		std::shared_ptr<fms::view<T>> base; // null while packed
+		std::unique_ptr<T[]> data; // owns base after unpacking
+		std::string packed;
+		size_t len; // characters in base
+		size_t last = 0; // compressed size when last packed
+		clock::time_point used;
+	public:
+		fms::charset::encoding charset = fms::charset::encoding::utf8;
+
+		shared_buffer(std::shared_ptr<fms::view<T>> base)
+			: base(base), len(base->len), used(clock::now())
+		{
+			if (auto b = dynamic_cast<const body*>(base.get())) {
+				charset = b->charset;
+			}
+		}
+
+		// start of the buffer, unpacked if needed
+		T* buf()
+		{
+			if (!base) {
+				data.reset(new T[len]);
+				auto n = fms::lz::decompress(packed, reinterpret_cast<char*>(data.get()), bytes());
+				ensure(n == bytes() || !__FUNCTION__ ": corrupt packed view");
+				base = std::make_shared<fms::view<T>>(data.get(), len);
+				std::string().swap(packed);
+			}
+			used = clock::now();
+
+			return base->buf;
+		}
+		// compress and release the buffer and return the bytes freed
+		size_t pack()
+		{
+			if (!base or len == 0 or last >= bytes()) {
+				return 0; // packed, empty, or incompressible
+			}
+
+			packed = fms::lz::compress(std::string_view(reinterpret_cast<const char*>(base->buf), bytes()));
+			last = packed.size();
+			if (last >= bytes()) {
+				std::string().swap(packed);
+
+				return 0;
+			}
+			packed.shrink_to_fit();
+			base.reset();
+			data.reset();
+
+			return bytes() - last;
+		}
+
+		bool is_packed() const
+		{
+			return !base;
+		}
+		size_t bytes() const
+		{
+			return len * sizeof(T);
+		}
+		// bytes held in memory
+		size_t resident() const
+		{
+			return base ? bytes() : packed.size();
+		}
+		// uncompressed over compressed size of the last packing or 0 if never packed
+		double ratio() const
+		{
+			return last ? static_cast<double>(bytes()) / last : 0;
+		}
+		clock::duration idle() const
+		{
+			return clock::now() - used;
+		}
+	};
+
+	// buffers of all views that might be packed
+	template<class T>
+	inline std::vector<std::weak_ptr<shared_buffer<T>>>& buffers()
+	{
+		static std::vector<std::weak_ptr<shared_buffer<T>>> buffers_;
+
+		return buffers_;
+	}
+
+	// contiguous copy of a rope made by rope_view::flatten()
+	template<class T>
+	struct flat_buffer {
+		std::unique_ptr<T[]> data; // null after being dropped
+		size_t len = 0;
+		std::chrono::steady_clock::time_point used;
+	};
+
+	// copies of all ropes that might be dropped
+	template<class T>
+	inline std::vector<std::weak_ptr<flat_buffer<T>>>& flats()
+	{
+		static std::vector<std::weak_ptr<flat_buffer<T>>> flats_;
+
+		return flats_;
+	}
+
+	// Pack buffers and drop copies of ropes idle for at least idle_time.
+	// Return the bytes freed.
+	template<class T>
+	inline size_t pack_idle()
+	{
+		size_t n = 0;
+
+		std::erase_if(flats<T>(), [&n](const auto& w) {
+			auto f = w.lock();
+			if (!f) {
+				return true;
+			}
+			if (idle_time.count() and f->data and std::chrono::steady_clock::now() - f->used >= idle_time) {
+				n += f->len * sizeof(T);
+				f->data.reset();
+			}
+
+			return false;
+		});
+
+		std::erase_if(buffers<T>(), [&n](const auto& w) {
+			auto b = w.lock();
+			if (!b) {
+				return true;
+			}
+			if (idle_time.count() and b->idle() >= idle_time) {
+				n += b->pack();
+			}
+
+			return false;
+		});
+
+		return n;
+	}
+
+	// View of a reference counted buffer. Slices point into the same
+	// buffer with their own offset and length and never modify it.
+	// Call touch() before using buf since the buffer might have been packed.
+	template<class T>
+	struct shared_view : public fms::view<T> {
+		std::shared_ptr<shared_buffer<T>> buffer;
+		size_t off = 0; // of buf in buffer
+		std::unique_ptr<fms::lines> lines; // built on first use by VIEW.LINE
+		// dialect found by CSV.SNIFF and the bytes it was found in
+		std::optional<fms::csv::sniffed> csv;
+		const T* csv_buf = nullptr;
+		size_t csv_len = 0;
+
+		shared_view(std::shared_ptr<fms::view<T>> base)
+			: fms::view<T>(base->buf, base->len), buffer(std::make_shared<shared_buffer<T>>(base))
+		{
+			buffers<T>().push_back(buffer);
+		}
+		// len characters of v starting at off
+		shared_view(const shared_view& v, size_t off, size_t len)
+			: fms::view<T>(v.buf + off, len), buffer(v.buffer), off(v.off + off)
+		{
+			ensure(off + len <= v.len || !__FUNCTION__ ": slice out of range");
+		}
+
+		// unpack the buffer and point buf into it
+		shared_view& touch()
+		{
+			this->buf = buffer->buf() + off;
+
+			return *this;
+		}
+	};
+
+	// Views of several buffers presented as one sequence without copying them.
+	// Functions that need contiguous memory call flatten() to get a copy
+	// that is dropped when idle like packed buffers.
+	template<class T>
+	struct rope_view : public fms::view<T> {
+		struct segment {
+			std::shared_ptr<shared_buffer<T>> buffer;
+			size_t off, len;
+		};
+		std::vector<segment> segments; // nonempty
+		std::vector<size_t> ends; // offset of the end of each segment
+		std::shared_ptr<flat_buffer<T>> flat; // made by flatten()
+		std::optional<fms::csv::sniffed> csv; // dialect from sniff(), reset by append
+
+		rope_view()
+			: fms::view<T>(nullptr, 0)
+		{ }
+
+		// append len characters of v starting at off
+		void append(const shared_view<T>& v, size_t off, size_t len)
+		{
+			ensure(off + len <= v.len || !__FUNCTION__ ": segment out of range");
+			if (len) {
+				segments.push_back(segment{ v.buffer, v.off + off, len });
+				this->len += len;
+				ends.push_back(this->len);
+				this->buf = nullptr;
+				flat.reset();
+				csv.reset();
+			}
+		}
+		void append(const rope_view& r)
+		{
+			for (const auto& s : r.segments) {
+				segments.push_back(s);
+				this->len += s.len;
+				ends.push_back(this->len);
+			}
+			this->buf = nullptr;
+			flat.reset();
+			csv.reset();
+		}
+
+		// call f(segment) in order until f returns false
+		template<class F>
+		bool each(F&& f) const
+		{
+			for (const auto& s : segments) {
+				if (!f(std::basic_string_view<T>(s.buffer->buf() + s.off, s.len))) {
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		// character at offset i
+		T operator[](size_t i) const
+		{
+			auto k = std::upper_bound(ends.begin(), ends.end(), i) - ends.begin();
+			ensure(static_cast<size_t>(k) < segments.size() || !__FUNCTION__ ": offset out of range");
+			const auto& s = segments[k];
+
+			return s.buffer->buf()[s.off + i - (k ? ends[k - 1] : 0)];
+		}
+
+		// characters of all segments in order
+		class iterator {
+			const rope_view* r;
+			size_t k, i; // segment and offset in it
+			const T* p; // start of segment k
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = T;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const T*;
+			using reference = const T&;
+
+			iterator(const rope_view* r = nullptr, size_t k = 0)
+				: r(r), k(k), i(0), p(nullptr)
+			{
+				if (r and k < r->segments.size()) {
+					p = r->segments[k].buffer->buf() + r->segments[k].off;
+				}
+			}
+			bool operator==(const iterator& j) const
+			{
+				return k == j.k and i == j.i;
+			}
+			reference operator*() const
+			{
+				return p[i];
+			}
+			iterator& operator++()
+			{
+				if (++i == r->segments[k].len) {
+					*this = iterator(r, k + 1);
+				}
+
+				return *this;
+			}
+			iterator operator++(int)
+			{
+				auto j = *this;
+				++*this;
+
+				return j;
+			}
+		};
+		iterator begin() const
+		{
+			return iterator(this, 0);
+		}
+		iterator end() const
+		{
+			return iterator(this, segments.size());
+		}
+
+		// contiguous copy of the rope made on use if it was never made or was dropped
+		rope_view& flatten()
+		{
+			if (!flat) {
+				flat = std::make_shared<flat_buffer<T>>();
+				flats<T>().push_back(flat);
+			}
+			if (!flat->data and this->len) {
+				flat->data.reset(new T[this->len]);
+				flat->len = this->len;
+				auto p = flat->data.get();
+				each([&p](std::basic_string_view<T> s) {
+					std::copy(s.begin(), s.end(), p);
+					p += s.size();
+					return true;
+				});
+			}
+			flat->used = std::chrono::steady_clock::now();
+			this->buf = flat->data.get();
+
+			return *this;
+		}
+	};
+
+	// view of handle h that can be sliced
+	template<class T>
+	inline shared_view<T>* shared(HANDLEX h)
+	{
+		handle<fms::view<T>> h_(h);
+		ensure(h_ || !__FUNCTION__ ": unrecognized handle");
+		auto v = dynamic_cast<shared_view<T>*>(h_.ptr());
+		ensure(v || !__FUNCTION__ ": handle is not a view returned by \\URL.VIEW");
+		v->touch();
+		pack_idle<T>();
+
+		return v;
+	}
+
+	// view of handle h with its buffer in memory
+	template<class T>
+	inline fms::view<T>* resident(HANDLEX h)
+	{
+		handle<fms::view<T>> h_(h);
+		ensure(h_ || !__FUNCTION__ ": unrecognized handle");
+		if (auto v = dynamic_cast<shared_view<T>*>(h_.ptr())) {
+			v->touch();
+		}
+		else if (auto r = dynamic_cast<rope_view<T>*>(h_.ptr())) {
+			r->flatten();
+		}
+		pack_idle<T>();
+
+		return h_.ptr();
+	}
+
+	// rope of handle h or nullptr if h is another kind of view
+	template<class T>
+	inline rope_view<T>* rope(HANDLEX h)
+	{
+		handle<fms::view<T>> h_(h);
+		ensure(h_ || !__FUNCTION__ ": unrecognized handle");
+
+		return dynamic_cast<rope_view<T>*>(h_.ptr());
+	}
+
+	// length of UTF-8 byte order mark at start of v
+	inline size_t bom(const fms::view<char>& v)
+	{
+		return v.len >= 3 and v.buf[0] == '\xEF' and v.buf[1] == '\xBB' and v.buf[2] == '\xBF' ? 3 : 0;
+	}
+	// characters of v after the byte order mark
+	inline fms::view<char> text(const fms::view<char>& v)
+	{
+		auto b = bom(v);
+
+		return fms::view<char>(v.buf + b, v.len - b);
+	}
+
+	// CSV dialect of view h sniffed from its first bytes and cached on shared views
+	// keyed by the address and length of the bytes and on ropes until they are appended to
+	inline fms::csv::sniffed sniff(HANDLEX h)
+	{
+		if (auto r = rope<char>(h)) {
+			if (!r->csv) {
+				// copy enough of the leading segments for fms::csv::sniff to sample
+				constexpr size_t n = (1 << 14) + 4;
+				std::string s;
+				r->each([&s](std::string_view segment) {
+					s.append(segment.substr(0, n - s.size()));
+					return s.size() < n;
+				});
+				r->csv = fms::csv::sniff(std::string_view(s).substr(s.starts_with("\xEF\xBB\xBF") ? 3 : 0));
+			}
+
+			return *r->csv;
+		}
+
+		auto v = resident<char>(h);
+		auto t = text(*v);
+		if (auto sv = dynamic_cast<shared_view<char>*>(v)) {
+			// sniff again if the view now points at other memory or has another length
+			if (!sv->csv or sv->csv_buf != t.buf or sv->csv_len != t.len) {
+				sv->csv = fms::csv::sniff(std::string_view(t.buf, t.len));
+				sv->csv_buf = t.buf;
+				sv->csv_len = t.len;
+			}
+
+			return *sv->csv;
+		}
+
+		return fms::csv::sniff(std::string_view(t.buf, t.len));
+	}
+
+	// CSV dialect of optional rs, fs, and esc arguments. If fs is "auto" the
+	// dialect is sniffed from view h and rs and esc override it if given.
+	inline fms::csv::dialect csv_dialect(HANDLEX h, const char* rs, const char* fs, const char* esc)
+	{
+		fms::csv::dialect d;
+		if (std::string_view(fs) == "auto") {
+			d = sniff(h).d;
+		}
+		else if (*fs) {
+			d.fs = *fs;
+		}
+		if (*rs) {
+			d.rs = *rs;
+		}
+		if (*esc) {
+			d.esc = *esc;
+		}
+
+		return d;
+	}
+
+#ifdef _DEBUG
+
+	// GB/s of f processing bytes repeated for at least 100 ms
+	template<class F>
+	inline double gbs(size_t bytes, F&& f)
+	{
+		using clock = std::chrono::steady_clock;
+
+		auto t0 = clock::now();
+		size_t k = 0;
+		volatile size_t sink = 0;
+		do {
+			sink = sink + f();
+			++k;
+		} while (clock::now() - t0 < std::chrono::milliseconds(100));
+
+		return k * bytes / 1e9 / std::chrono::duration<double>(clock::now() - t0).count();
+	}
+
+#endif // _DEBUG
+
+} // namespace xll
@@ -0,0 +1,253 @@
+// xll_wikidata.cpp - batched wikidata entity retrieval
+// https://www.wikidata.org/w/api.php?action=help&modules=wbgetentities
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "xll_inet.h"
+#include "xll_json.h"
+
+#define WIKIDATA_URL "https://www.wikidata.org/w/api.php?action=wbgetentities&format=json"
+
+using namespace xll;
+
+namespace wikidata {
+
+	// wbgetentities accepts at most 50 ids per request
+	constexpr size_t max_ids = 50;
+	// collect ids for this long after the last one was requested
+	constexpr auto window = std::chrono::milliseconds(20);
+
+	// Cells register ids and a worker thread sends them in multi-id requests.
+	class batch {
+		struct request {
+			std::string id;
+			XLOPERX async; // handle for xlAsyncReturn
+		};
+		// "&props=...&languages=..." to requests
+		std::map<std::string, std::vector<request>> queue;
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::chrono::steady_clock::time_point last;
+		bool done = false;
+		std::thread worker;
+
+		bool full() const
+		{
+			for (const auto& [query, requests] : queue) {
+				if (requests.size() >= max_ids) {
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		void run()
+		{
+			std::unique_lock lock(mutex);
+
+			while (!done) {
+				if (queue.empty()) {
+					cv.wait(lock);
+				}
+				else if (!full() and std::chrono::steady_clock::now() < last + window) {
+					cv.wait_until(lock, last + window);
+				}
+				else {
+					auto q = std::move(queue);
+					queue.clear();
+					lock.unlock();
+					for (const auto& [query, requests] : q) {
+						send(query, requests);
+					}
+					lock.lock();
+				}
+			}
+		}
+
+		// Entities of ids by id. Return false if the request fails or has an error,
+		// e.g., a malformed id. Unknown ids are "missing" entities and are left out.
+		static bool get(const std::string& query, const std::set<std::string>& ids, std::map<std::string, std::string>& entities)
+		{
+			std::string url = WIKIDATA_URL + query + "&ids=";
+			for (const auto& id : ids) {
+				if (url.back() != '=') {
+					url.append("%7C"); // '|'
+				}
+				url.append(id);
+			}
+
+			try {
+				xll::body v; // transcoded to UTF-8 by read_url
+				Inet::read_url(std::basic_string<TCHAR>(url.begin(), url.end()).c_str(),
+					USER_AGENT_HEADER, static_cast<DWORD>(-1L), 0, v);
+				std::string_view body(v.buf, v.len);
+				if (json::scan::member(body, "error").size()) {
+					return false;
+				}
+				auto es = json::scan::member(body, "entities");
+				if (es.empty()) {
+					return false;
+				}
+				json::scan::members(es, [&entities](std::string_view key, std::string_view entity) {
+					if (json::scan::member(entity, "missing").empty()) {
+						entities.emplace(key, entity);
+					}
+				});
+			}
+			catch (const std::exception&) {
+				return false;
+			}
+
+			return true;
+		}
+
+		// one request per max_ids distinct ids, parse once, and route entities to cells
+		static void send(const std::string& query, const std::vector<request>& requests)
+		{
+			std::vector<std::string> ids;
+			for (const auto& r : requests) {
+				if (std::find(ids.begin(), ids.end(), r.id) == ids.end()) {
+					ids.push_back(r.id);
+				}
+			}
+
+			for (size_t i = 0; i < ids.size(); i += max_ids) {
+				std::set<std::string> chunk(ids.begin() + i, ids.begin() + std::min(i + max_ids, ids.size()));
+
+				std::map<std::string, std::string> entities;
+				if (!get(query, chunk, entities) and chunk.size() > 1) {
+					// one bad id fails the whole request so ask for each id alone
+					for (const auto& id : chunk) {
+						get(query, { id }, entities);
+					}
+				}
+
+				for (const auto& r : requests) {
+					if (!chunk.contains(r.id)) {
+						continue;
+					}
+
+					OPER o = ErrNA;
+					if (auto e = entities.find(r.id); e != entities.end()) {
+						o = utf8(e->second);
+					}
+					Excel(xlAsyncReturn, r.async, o);
+				}
+			}
+		}
+	public:
+		batch() = default;
+		batch(const batch&) = delete;
+		batch& operator=(const batch&) = delete;
+		~batch()
+		{
+			stop();
+		}
+
+		// join the worker outside of DllMain
+		void stop()
+		{
+			{
+				std::lock_guard lock(mutex);
+				done = true;
+			}
+			cv.notify_one();
+			if (worker.joinable()) {
+				worker.join();
+			}
+		}
+
+		void add(const std::string& query, const std::string& id, const XLOPERX& async)
+		{
+			{
+				std::lock_guard lock(mutex);
+				if (!worker.joinable()) {
+					done = false;
+					worker = std::thread([this]() { run(); });
+				}
+				queue[query].push_back(request{ id, async });
+				last = std::chrono::steady_clock::now();
+			}
+			cv.notify_one();
+		}
+	};
+
+	static batch entities;
+
+} // namespace wikidata
+
+Auto<Close> xac_wikidata([]() {
+	wikidata::entities.stop();
+
+	return TRUE;
+});
+
+AddIn xai_wikidata_entity(
+	Function(XLL_VOID, "xll_wikidata_entity", "WIKIDATA.ENTITY")
+	.Arguments({
+		Arg(XLL_CSTRING4, "id", "is a wikidata entity id.", "\"Q64\""),
+		Arg(XLL_CSTRING4, "_props", "is an optional '|' separated list of properties to return."),
+		Arg(XLL_CSTRING4, "_languages", "is an optional '|' separated list of languages to return."),
+		})
+	.Asynchronous()
+	.Category("WIKIDATA")
+	.FunctionHelp("Return the JSON string of a wikidata entity.")
+	.HelpTopic("https://www.wikidata.org/w/api.php?action=help&modules=wbgetentities")
+	.Documentation(R"xyzyx(
+Return the JSON for the entity <code>id</code> using
+<a href="https://www.wikidata.org/w/api.php?action=help&modules=wbgetentities">wbgetentities</a>.
+Cells calling this function during a recalculation are batched so up to 50 ids
+having the same <code>_props</code> and <code>_languages</code> are retrieved
+in one request. Use <code>JSON.PARSE</code> on the result.
+<p>
+Ids are not case sensitive. Unknown and malformed ids return <code>#N/A</code>
+without affecting the other ids in the batch. Entities longer than 32767 characters return
+<code>#VALUE!</code> so use <code>_props</code> to return only the properties needed,
+e.g., <code>"labels|descriptions"</code>.
+</p>
+)xyzyx")
+);
+void WINAPI xll_wikidata_entity(const char* id, const char* props, const char* languages, LPXLOPERX phandle)
+{
+#pragma XLLEXPORT
+	try {
+		ensure(*id || !__FUNCTION__ ": id must not be empty");
+
+		// '|' separated lists encoded like the ids
+		auto list = [](std::string& query, const char* name, std::string_view l) {
+			query.append(name);
+			for (auto c : l) {
+				if (c == '|') {
+					query.append("%7C");
+				}
+				else {
+					query.push_back(c);
+				}
+			}
+		};
+		std::string query;
+		if (*props) {
+			list(query, "&props=", props);
+		}
+		if (*languages) {
+			list(query, "&languages=", languages);
+		}
+
+		// entity keys are upper case, e.g., "q64" is returned as "Q64"
+		std::string key(id);
+		std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+
+		wikidata::entities.add(query, key, *phandle);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		Excel(xlAsyncReturn, *phandle, ErrNA);
+	}
+}
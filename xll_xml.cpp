@@ -3,6 +3,8 @@
 #include "libxml2.h"
 #include "xll/xll/xll.h"
 #include "fms_parse/win_mem_view.h"
+#include "xll_utf8.h"
+#include "xll_view.h"
 
 #define CATEGORY "XML"
 
@@ -60,6 +62,23 @@ XML_PARSER_OPTION_ENUM(XML_PARSE_DATA)
 #undef XML_PARSE_TOPIC
 #undef XML_PARSE_DATA
 
+// views converted to UTF-8 by \URL.VIEW must not be decoded using the document encoding declaration
+inline const char* view_encoding(HANDLEX str, const char* encoding)
+{
+	if (*encoding) {
+		return encoding;
+	}
+
+	handle<fms::view<char>> str_(str);
+	if (auto v = dynamic_cast<shared_view<char>*>(str_.ptr())) {
+		if (v->buffer->charset != fms::charset::encoding::utf8) {
+			return "UTF-8";
+		}
+	}
+
+	return nullptr;
+}
+
 AddIn xai_xml_document(
 	Function(XLL_HANDLEX, "xll_xml_document", "\\XML.DOCUMENT")
 	.Arguments({
@@ -81,10 +100,10 @@ HANDLEX WINAPI xll_xml_document(HANDLEX str, const char* url, const char* encodi
 	HANDLEX h = INVALID_HANDLEX;
 
 	try {
-		handle<fms::view<char>> str_(str);
+		auto str_ = resident<char>(str);
 		//options |= XML_PARSE_HUGE;
 		if (!*url) url = nullptr;
-		if (!*encoding) encoding = nullptr;
+		encoding = view_encoding(str, encoding);
 		handle<xml::document> h_(new xml::document(str_->buf, str_->len, url, encoding, options));
 
 		h = h_.get();
@@ -138,10 +157,10 @@ HANDLEX WINAPI xll_html_document(HANDLEX str, const char* url, const char* encod
 	HANDLEX h = INVALID_HANDLEX;
 
 	try {
-		handle<fms::view<char>> str_(str);
+		auto str_ = resident<char>(str);
 		//options |= XML_PARSE_HUGE;
 		if (!*url) url = nullptr;
-		if (!*encoding) encoding = nullptr;
+		encoding = view_encoding(str, encoding);
 		handle<xml::document> h_(new html::document(str_->buf, str_->len, url, encoding, options));
 
 		h = h_.get();
@@ -214,8 +233,8 @@ LPOPER WINAPI xll_xml_node_attributes(HANDLEX pnode)
 			OPER v;
 			xmlAttrPtr cur = node->properties;
 			while (cur and cur->name and cur->children) {
-				o.push_back(OPER((const char*)cur->name));
-				v.push_back(OPER(xml::node(cur->children).content()));
+				o.push_back(utf8((const char*)cur->name));
+				v.push_back(utf8(xml::node(cur->children).content().ptr()));
 				cur = cur->next;
 			}
 			o.resize(1, o.size());
@@ -250,7 +269,7 @@ LPOPER WINAPI xll_xml_node_content(HANDLEX pnode)
 		auto node = xml::node(safe_pointer<xmlNode>(pnode));
 
 		if (node) {
-			o = node.content();
+			o = utf8(node.content().ptr());
 		}
 		else {
 			o = ErrNA;
@@ -283,7 +302,7 @@ LPOPER WINAPI xll_xml_node_list(HANDLEX pnode)
 		auto node = xml::node(safe_pointer<xmlNode>(pnode));
 
 		if (node) {
-			o = node.list();
+			o = utf8(node.list().ptr());
 		}
 		else {
 			o = ErrNA;
@@ -316,7 +335,7 @@ LPOPER WINAPI xll_xml_node_name(HANDLEX pnode)
 		auto node = xml::node(safe_pointer<xmlNode>(pnode));
 
 		if (pnode) {
-			o = node.name();
+			o = utf8(node.name());
 		}
 		else {
 			o = ErrNA;
@@ -559,7 +578,7 @@ LPOPER WINAPI xll_xml_node_path(HANDLEX pnode)
 		auto node = xml::node(safe_pointer<xmlNode>(pnode));
 
 		if (node) {
-			o = node.path();
+			o = utf8(node.path().ptr());
 		}
 		else {
 			o = ErrNA;
@@ -1,5 +1,5 @@
 // xll_yahoo.cpp - Yahoo! finance urls
-#include "xll/xll/xll.h"
+#include "xll_inet.h"
 
 #define YAHOO_URL "https://query1.finance.yahoo.com/v7/finance/download/"
 
@@ -92,6 +92,7 @@ AddIn xai_yahoo_finance(
 	.HelpTopic("https://finance.yahoo.com/")
 	.Documentation(R"xyzyx(
 Return URL for Yahoo! finance.
+If <code>INET.PREFETCH(TRUE)</code> was called and <code>end</code> is not missing the URL is read in the background.
 )xyzyx")
 );
 LPOPER WINAPI xll_yahoo_finance(LPOPER psymbol, double start, double end, xcstr interval)
@@ -108,6 +109,10 @@ LPOPER WINAPI xll_yahoo_finance(LPOPER psymbol, double start, double end, xcstr
 		o.append("?period1=").append(fixed(xll_mktime(start)));
 		o.append("&period2=").append(fixed(xll_mktime(end ? OPER(end) : Excel(xlfNow))));
 		o.append("&interval=").append(*interval ? interval : _T("1d"));
+
+		if (end) {
+			Inet::prefetch_url(o); // the url changes with NOW() if end is missing
+		}
 	}
 	catch (const std::exception& ex) {
 		XLL_ERROR(ex.what());